@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include <QThread>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUrl>
+#include <QDebug>
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QAudioFormat>
+
+#include "analysisscheduler.h"
+
+AnalysisScheduler::AnalysisScheduler(QObject* parent) noexcept : QObject(parent) {
+    /*
+     * 分析是低优先级的后台工作：最多占用一半逻辑核心，线程以最低优先级运行
+     */
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    pool.setThreadPriority(QThread::LowestPriority);
+}
+
+AnalysisScheduler::~AnalysisScheduler() {
+    clear();
+    pool.waitForDone();
+}
+
+void AnalysisScheduler::enqueue(const QString& path) noexcept {
+    /*
+     * 加入分析队列，已经在队列中或正在分析的曲目不会重复加入
+     */
+    if (queued.contains(path)) return;
+    queued.insert(path);
+    pending.push_back(path);
+    startJobs();
+}
+
+void AnalysisScheduler::remove(const QString& path) noexcept {
+    /*
+     * 曲目从播放列表移除后不再分析，正在分析的结果到达时会被丢弃
+     */
+    if (!queued.remove(path)) return;
+    const auto it = std::find(pending.begin(), pending.end(), path);
+    if (it != pending.end()) pending.erase(it);
+}
+
+void AnalysisScheduler::remove(const QStringList& paths) noexcept {
+    /*
+     * 批量移除时只遍历一次等待队列，避免每个路径都线性查找一遍
+     */
+    bool removed = false;
+    for (const QString& path : paths) removed |= queued.remove(path);
+    if (!removed) return;
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [this](const QString& path) { return !queued.contains(path); }), pending.end());
+}
+
+void AnalysisScheduler::clear() noexcept {
+    /*
+     * 清空队列，正在进行的解码会在下一个缓冲区到达时中止
+     */
+    generation++;
+    pending.clear();
+    queued.clear();
+}
+
+void AnalysisScheduler::setPlaybackActive(bool active) noexcept {
+    /*
+     * 播放时让出 CPU：核心数不多于两个时暂停分析，否则只保留一个任务
+     */
+    playing = active;
+    startJobs();
+}
+
+bool AnalysisScheduler::isIdle() const noexcept {
+    return running == 0 && pending.empty();
+}
+
+int AnalysisScheduler::jobLimit() const noexcept {
+    if (!playing) return pool.maxThreadCount();
+    return QThread::idealThreadCount() <= 2 ? 0 : 1;
+}
+
+void AnalysisScheduler::startJobs() noexcept {
+    /*
+     * 同时运行的任务数受 jobLimit 限制，其余留在队列中，一个任务完成后再启动下一个
+     */
+    const quint64 gen = generation.load();
+    while (running < jobLimit() && !pending.empty()) {
+        const QString path = pending.front();
+        pending.pop_front();
+        running++;
+        pool.start([this, path, gen] {
+            TrackAnalysis result;
+            const bool ok = analyze(path, result, generation, gen);
+            QMetaObject::invokeMethod(this, [this, path, result, ok, gen] { deliver(path, result, ok, gen); }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void AnalysisScheduler::deliver(const QString& path, const TrackAnalysis& analysis, bool ok, quint64 gen) noexcept {
+    /*
+     * 在主线程中转发结果并接着启动队列中的下一个任务。
+     * 超时的曲目留在 queued 中，本次运行不再重新加入，避免反复解码同一个卡住的文件
+     */
+    running--;
+    if (ok && gen == generation.load() && queued.remove(path)) emit analyzed(path, analysis);
+    startJobs();
+}
+
+bool AnalysisScheduler::analyze(const QString& path, TrackAnalysis& result, const std::atomic<quint64>& generation, quint64 expected) noexcept {
+    /*
+     * 在工作线程中阻塞解码整首曲目并交给 TrackAnalyzer。解码出错时用已解出的部分给出结果，
+     * 这样损坏的文件也有记录，不会在每次启动时重新分析；被取消时返回 false。
+     * 30 秒没有新数据的解码视为卡住，同样返回 false，不把半截结果当作完整分析保存，下次启动时重新分析
+     */
+    QAudioFormat format;
+    format.setSampleRate(44100);
+    format.setChannelCount(2);
+    format.setChannelConfig(QAudioFormat::ChannelConfigStereo);
+    format.setSampleFormat(QAudioFormat::Int16);
+    TrackAnalyzer analyzer(format.sampleRate());
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    QTimer watchdog;
+    watchdog.setSingleShot(true);
+    watchdog.setInterval(30000);
+    bool cancelled = false, timedOut = false;
+    std::vector<qint16> converted;
+    QObject::connect(&watchdog, &QTimer::timeout, &loop, [&] {
+        timedOut = true;
+        decoder.stop();
+        loop.quit();
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&] {
+        if (generation.load() != expected) {
+            cancelled = true;
+            decoder.stop();
+            loop.quit();
+            return;
+        }
+        watchdog.start();
+        while (decoder.bufferAvailable()) {
+            const QAudioBuffer buffer = decoder.read();
+            if (!buffer.isValid()) continue;
+            const QAudioFormat from = buffer.format();
+            const qint64 count = buffer.frameCount();
+            const qint16* samples = buffer.constData<qint16>();
+            if (from != format) {
+                const int channels = from.channelCount();
+                const int bytes = from.bytesPerSample();
+                const char* data = buffer.constData<char>();
+                converted.resize(count * 2);
+                for (qint64 f = 0; f < count; f++) for (int c = 0; c < 2; c++) {
+                    const float value = from.normalizedSampleValue(data + (f * channels + std::min(c, channels - 1)) * bytes);
+                    converted[f * 2 + c] = qint16(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+                }
+                samples = converted.data();
+            }
+            analyzer.process(samples, count);
+        }
+    });
+    decoder.setAudioFormat(format);
+    decoder.setSource(QUrl::fromLocalFile(path));
+    decoder.start();
+    watchdog.start();
+    loop.exec();
+    if (cancelled || generation.load() != expected) return false;
+    if (timedOut) {
+        qWarning() << "分析超时，已放弃：" << path;
+        return false;
+    }
+    result = analyzer.finish();
+    return true;
+}
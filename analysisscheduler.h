@@ -0,0 +1,47 @@
+#ifndef ANALYSISSCHEDULER_H
+#define ANALYSISSCHEDULER_H
+
+#include <atomic>
+#include <deque>
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "trackanalysis.h"
+
+class AnalysisScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit AnalysisScheduler(QObject* parent = nullptr) noexcept;
+    ~AnalysisScheduler();
+
+    void enqueue(const QString& path) noexcept;
+    void remove(const QString& path) noexcept;
+    void remove(const QStringList& paths) noexcept;
+    void clear() noexcept;
+    void setPlaybackActive(bool active) noexcept;
+    bool isIdle() const noexcept;
+
+    static bool analyze(const QString& path, TrackAnalysis& result, const std::atomic<quint64>& generation, quint64 expected) noexcept;
+
+signals:
+    void analyzed(const QString& path, const TrackAnalysis& analysis);
+
+private:
+    void startJobs() noexcept;
+    void deliver(const QString& path, const TrackAnalysis& analysis, bool ok, quint64 generation) noexcept;
+    int jobLimit() const noexcept;
+
+    QThreadPool pool;
+    std::deque<QString> pending;
+    QSet<QString> queued;  // pending 与正在分析的路径
+    std::atomic<quint64> generation{0};
+    int running{0};
+    bool playing{false};
+};
+
+#endif // ANALYSISSCHEDULER_H
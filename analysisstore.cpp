@@ -0,0 +1,77 @@
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QList>
+
+#include "analysisstore.h"
+
+AnalysisStore::AnalysisStore(const QString& directory) noexcept : m_directory(directory) {}
+
+void AnalysisStore::setDirectory(const QString& directory) noexcept {
+    m_directory = directory;
+}
+
+bool AnalysisStore::load() noexcept {
+    /*
+     * 顺序读取整个分析结果文件，魔数或版本不符时丢弃，之后所有曲目都会重新分析
+     */
+    m_entries.clear();
+    m_dirty = false;
+    QFile file{m_directory + "/analysis.cache"};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, count;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version) return false;
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count; i++) {
+        QString path;
+        Entry e;
+        in >> path >> e.size >> e.mtime >> e.analysis.loudness >> e.analysis.peak >> e.analysis.bpm >> e.analysis.waveform;
+        if (in.status() != QDataStream::Ok) {
+            m_entries.clear();
+            return false;
+        }
+        m_entries.insert(path, e);
+    }
+    return true;
+}
+
+bool AnalysisStore::save(const std::vector<QString>& playlist) noexcept {
+    /*
+     * 按播放列表顺序写出，不在列表中的条目随之被清理
+     */
+    if (!m_dirty) return true;
+    QDir{}.mkpath(m_directory);
+    QSaveFile file{m_directory + "/analysis.cache"};
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out{&file};
+    out.setVersion(QDataStream::Qt_6_0);
+    QList<const QString*> paths;
+    paths.reserve(qsizetype(playlist.size()));
+    for (const QString& path : playlist) if (m_entries.contains(path)) paths.append(&path);
+    out << Magic << Version << quint32(paths.size());
+    for (const QString* path : paths) {
+        const Entry& e = m_entries[*path];
+        out << *path << e.size << e.mtime << e.analysis.loudness << e.analysis.peak << e.analysis.bpm << e.analysis.waveform;
+    }
+    if (!file.commit()) return false;
+    m_dirty = false;
+    return true;
+}
+
+const TrackAnalysis* AnalysisStore::lookup(const QString& path, qint64 size, qint64 mtime) const noexcept {
+    /*
+     * 文件大小和修改时间与分析时一致才算有效，文件被修改过的曲目需要重新分析
+     */
+    const auto it = m_entries.constFind(path);
+    if (it == m_entries.cend() || it->size != size || it->mtime != mtime) return nullptr;
+    return &it->analysis;
+}
+
+void AnalysisStore::store(const QString& path, qint64 size, qint64 mtime, const TrackAnalysis& analysis) noexcept {
+    m_entries.insert(path, Entry{size, mtime, analysis});
+    m_dirty = true;
+}
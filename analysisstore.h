@@ -0,0 +1,36 @@
+#ifndef ANALYSISSTORE_H
+#define ANALYSISSTORE_H
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+
+#include "trackanalysis.h"
+
+class AnalysisStore {
+public:
+    explicit AnalysisStore(const QString& directory = QString()) noexcept;
+
+    void setDirectory(const QString& directory) noexcept;
+    bool load() noexcept;
+    bool save(const std::vector<QString>& paths) noexcept;
+
+    const TrackAnalysis* lookup(const QString& path, qint64 size, qint64 mtime) const noexcept;
+    void store(const QString& path, qint64 size, qint64 mtime, const TrackAnalysis& analysis) noexcept;
+
+private:
+    struct Entry {
+        qint64 size, mtime;
+        TrackAnalysis analysis;
+    };
+
+    static constexpr quint32 Magic = 0x574D4131; // "WMA1"
+    static constexpr quint32 Version = 2;
+
+    QString m_directory;
+    QHash<QString, Entry> m_entries;
+    bool m_dirty{false};
+};
+
+#endif // ANALYSISSTORE_H
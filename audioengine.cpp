@@ -0,0 +1,837 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QIODevice>
+#include <QAudioSink>
+#include <QAudioDevice>
+#include <QAudioBuffer>
+#include <QMediaDevices>
+#include <QMutexLocker>
+
+#include "audioengine.h"
+#include "audiokernels.h"
+#include "loudnessmeter.h"
+
+namespace {
+
+constexpr int Channels = 2;
+constexpr float HalfPi = 1.57079632679f;
+constexpr float SampleScale = 1.0f / 32768.0f;
+
+}
+
+/*
+ * 一首曲目解码后的 PCM。解码线程把数据写进固定大小的环形缓冲，最多领先读取位置 capacity 帧，
+ * 音频线程从读取位置往后读；缓冲里保存的是 frames 之前的最多 capacity 帧
+ */
+struct AudioEngine::Stream {
+    explicit Stream(const QUrl& source) noexcept : source(source) {}
+    ~Stream();
+
+    QUrl source;
+    Decoder* decoder{nullptr};  // 还没开始解码时为空，只在主线程中访问；对象本身属于解码线程
+    std::unique_ptr<qint16[]> ring;
+    qint64 capacity{0};
+    qint64 frames{0};     // 本轮解码已经产出的帧数，也就是缓冲中最后一帧之后的位置
+    qint64 expected{-1};  // 解码器报告的时长（毫秒），解码完成前用来估计总时长
+    int generation{0};    // 每次从头重新解码时加一，解码线程据此丢掉上一轮的数据
+    bool complete{false};
+    bool stalled{false};  // 缓冲已满，解码线程等待音频线程读走数据后再继续
+    float tagGain{std::numeric_limits<float>::quiet_NaN()};       // 标签中的曲目增益（dB）
+    float measuredGain{std::numeric_limits<float>::quiet_NaN()};  // 解码完成后测出的增益（dB）
+    float scale{1.0f};    // 实际施加的线性增益，不含音量
+};
+
+/*
+ * 在解码线程中运行的解码器：把解码结果转换成设备格式（声道、采样格式、采样率），测量响度，再写进曲目的环形缓冲
+ */
+class AudioEngine::Decoder : public QObject {
+public:
+    Decoder(AudioEngine* engine, const std::shared_ptr<Stream>& stream) noexcept
+        : engine(engine), stream(stream), source(stream->source), meter(engine->format.sampleRate()) {}
+
+    void run() noexcept;
+    void pump() noexcept;
+
+private:
+    void convert(const QAudioBuffer& buffer) noexcept;
+    bool store() noexcept;
+    void finish() noexcept;
+    void notify() noexcept;
+
+    AudioEngine* engine;
+    std::weak_ptr<Stream> stream;
+    QUrl source;
+    QAudioDecoder* decoder{nullptr};
+    int generation{-1};
+    bool active{false}, drained{false}, announced{false};
+    QString error;
+    std::vector<float> input, resampled;
+    std::vector<qint16> pending;  // 已经转换好、还没放进缓冲的数据
+    qint64 written{0};            // pending 中已经写入缓冲的帧数
+    qint64 position{0};           // 本轮解码已经转换的帧数
+    double phase{0.0};            // 重采样时下一个输出帧在输入中的位置，相对于上一段的最后一帧
+    LoudnessMeter meter;
+    qint64 metered{0};            // 已经送进响度计的帧数，重新解码时不重复测量
+};
+
+AudioEngine::Stream::~Stream() {
+    if (decoder) decoder->deleteLater();
+}
+
+void AudioEngine::Decoder::run() noexcept {
+    /*
+     * 从头开始解码。QAudioDecoder 不能跳转，往回跳到缓冲之外时也走这里，由 store() 丢掉目标位置之前的数据
+     */
+    const auto stream = this->stream.lock();
+    if (!stream) return;
+    if (!decoder) {
+        decoder = new QAudioDecoder(this);
+        connect(decoder, &QAudioDecoder::bufferReady, this, &Decoder::pump);
+        connect(decoder, &QAudioDecoder::finished, this, [this] {
+            drained = true;
+            pump();
+        });
+        connect(decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error), this, [this] {
+            if (!active) return;
+            error = decoder->errorString();
+            drained = true;
+            pump();
+        });
+        connect(decoder, &QAudioDecoder::durationChanged, this, [this](qint64 duration) {
+            const auto stream = this->stream.lock();
+            if (!stream) return;
+            {
+                QMutexLocker lock(&engine->mutex);
+                stream->expected = duration;
+            }
+            notify();
+        });
+        decoder->setAudioFormat(engine->format);
+        decoder->setSource(source);
+    }
+    active = false;
+    decoder->stop();
+    {
+        QMutexLocker lock(&engine->mutex);
+        generation = stream->generation;
+    }
+    pending.clear();
+    written = position = 0;
+    phase = 0.0;
+    drained = announced = false;
+    error.clear();
+    active = true;
+    decoder->start();
+}
+
+void AudioEngine::Decoder::pump() noexcept {
+    /*
+     * 先把上次没放下的数据写进缓冲，再继续从解码器取数据。缓冲满时停下不再读取，解码器自己的队列随之停止增长，
+     * 等主线程发现音频线程读走了一半缓冲后再调用这里
+     */
+    if (!active) return;
+    while (pending.empty() || store()) {
+        if (!decoder->bufferAvailable()) {
+            if (drained) finish();
+            return;
+        }
+        const QAudioBuffer buffer = decoder->read();
+        if (buffer.isValid()) convert(buffer);
+    }
+}
+
+void AudioEngine::Decoder::convert(const QAudioBuffer& buffer) noexcept {
+    /*
+     * 解码器一般已经按请求的格式输出，后端做不到时在这里逐个采样转换声道数和采样格式；
+     * 采样率不同时做线性插值重采样，上一段的最后一帧留作插值的起点。转换结果放进 pending 并送进响度计
+     */
+    const QAudioFormat from = buffer.format();
+    const qint64 count = buffer.frameCount();
+    if (count <= 0 || !from.isValid()) return;
+    const QAudioFormat& to = engine->format;
+    if (from == to) {
+        const qint16* samples = buffer.constData<qint16>();
+        pending.assign(samples, samples + count * Channels);
+    } else {
+        const int channels = from.channelCount();
+        const int bytes = from.bytesPerSample();
+        const char* data = buffer.constData<char>();
+        const bool resample = from.sampleRate() != to.sampleRate();
+        input.resize((count + 1) * Channels);
+        float* frames = input.data() + (resample ? Channels : 0);
+        for (qint64 f = 0; f < count; f++) for (int c = 0; c < Channels; c++)
+            frames[f * Channels + c] = from.normalizedSampleValue(data + (f * channels + std::min(c, channels - 1)) * bytes);
+        const float* converted = frames;
+        qint64 produced = count;
+        if (resample) {
+            if (position == 0 && phase == 0.0) std::copy(frames, frames + Channels, input.data());
+            const double step = double(from.sampleRate()) / double(to.sampleRate());
+            resampled.clear();
+            double t = phase;
+            for (; t < double(count); t += step) {
+                const qint64 i = qint64(t);
+                const float w = float(t - double(i));
+                for (int c = 0; c < Channels; c++) {
+                    const float a = input[i * Channels + c], b = input[(i + 1) * Channels + c];
+                    resampled.push_back(a + (b - a) * w);
+                }
+            }
+            phase = t - double(count);
+            std::copy(frames + (count - 1) * Channels, frames + count * Channels, input.data());
+            converted = resampled.data();
+            produced = qint64(resampled.size()) / Channels;
+        }
+        pending.resize(produced * Channels);
+        AudioKernels::toInt16(converted, pending.data(), produced * Channels);
+    }
+    const qint64 frames = qint64(pending.size()) / Channels;
+    const qint64 skip = std::min(std::max<qint64>(metered - position, 0), frames);
+    if (skip < frames) meter.process(pending.data() + skip * Channels, frames - skip);
+    position += frames;
+    metered = std::max(metered, position);
+    written = 0;
+}
+
+bool AudioEngine::Decoder::store() noexcept {
+    /*
+     * 把 pending 写进环形缓冲，全部写完时返回 true。读取位置之前的帧（跳转越过的部分）直接丢掉；
+     * 写满时标记 stalled 并返回 false。主线程已经要求从头重新解码时丢掉这一轮的数据，等待 run()
+     */
+    const auto stream = this->stream.lock();
+    const qint64 total = qint64(pending.size()) / Channels;
+    bool first = false;
+    {
+        QMutexLocker lock(&engine->mutex);
+        if (!stream || stream->generation != generation) {
+            active = false;
+            return false;
+        }
+        const qint64 read = engine->readPosition(*stream);
+        while (written < total) {
+            const qint64 frame = stream->frames;
+            if (read < 0 || frame >= read + stream->capacity) {
+                stream->stalled = true;
+                break;
+            }
+            qint64 n = total - written;
+            if (frame < read) n = std::min(n, read - frame);
+            else {
+                const qint64 offset = frame % stream->capacity;
+                n = std::min({n, read + stream->capacity - frame, stream->capacity - offset});
+                std::memcpy(stream->ring.get() + offset * Channels, pending.data() + written * Channels, n * Channels * sizeof(qint16));
+                first = first || !announced;
+            }
+            stream->frames += n;
+            written += n;
+        }
+    }
+    if (first) {
+        announced = true;
+        notify();
+    }
+    if (written < total) return false;
+    pending.clear();
+    written = 0;
+    return true;
+}
+
+void AudioEngine::Decoder::finish() noexcept {
+    /*
+     * 解码结束或出错时把已经写入的部分当作完整曲目，同时用测得的响度更新增益
+     */
+    active = false;
+    const auto stream = this->stream.lock();
+    if (!stream) return;
+    {
+        QMutexLocker lock(&engine->mutex);
+        if (stream->generation != generation) return;
+        stream->complete = true;
+        stream->measuredGain = float(meter.replayGain());
+        stream->scale = engine->streamScale(*stream);
+    }
+    QMetaObject::invokeMethod(engine, [engine = engine, stream = this->stream, error = error] {
+        engine->decodingFinished(stream, error);
+    }, Qt::QueuedConnection);
+}
+
+void AudioEngine::Decoder::notify() noexcept {
+    QMetaObject::invokeMethod(engine, [engine = engine, stream = this->stream] { engine->decodingProgress(stream); }, Qt::QueuedConnection);
+}
+
+/*
+ * 音频设备以拉取模式从这里读数据，每次读取都交给 AudioEngine::render 混出
+ */
+class AudioEngine::Output : public QIODevice {
+public:
+    explicit Output(AudioEngine* engine) noexcept : engine(engine) {}
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return qint64(1) << 20; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override {
+        const qint64 frameBytes = Channels * qint64(sizeof(qint16));
+        return engine->render(reinterpret_cast<qint16*>(data), maxSize / frameBytes) * frameBytes;
+    }
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    AudioEngine* engine;
+};
+
+AudioEngine::AudioEngine(QObject* parent) noexcept : QObject(parent), output(std::make_unique<Output>(this)) {
+    /*
+     * 所有曲目都转换成设备首选采样率的 16 位立体声，切歌时不需要重新打开设备
+     */
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    const int rate = device.preferredFormat().sampleRate();
+    format.setSampleRate(rate > 0 ? rate : 44100);
+    format.setChannelCount(Channels);
+    format.setChannelConfig(QAudioFormat::ChannelConfigStereo);
+    format.setSampleFormat(QAudioFormat::Int16);
+    if (!device.isFormatSupported(format)) format.setSampleRate(44100);
+    setCrossfade(0, Linear);
+    limiter.setSampleRate(format.sampleRate());
+    rampFrames = std::max(1, format.sampleRate() / 20);
+    mix.reserve(format.sampleRate() * Channels);
+    delay = limiter.latency();
+    sink = std::make_unique<QAudioSink>(device, format);
+    sink->setBufferSize(format.bytesForDuration(200000));
+    output->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    ticker.setInterval(50);
+    connect(&ticker, &QTimer::timeout, this, &AudioEngine::tick);
+    decoding.start();
+}
+
+AudioEngine::~AudioEngine() {
+    /*
+     * 释放曲目会让各自的解码器在解码线程中析构，线程退出前处理完这些删除
+     */
+    sink->stop();
+    {
+        QMutexLocker lock(&mutex);
+        current.reset();
+        next.reset();
+        previous.reset();
+    }
+    decoding.quit();
+    decoding.wait();
+}
+
+void AudioEngine::setSource(const QUrl& source, float replayGain) noexcept {
+    /*
+     * 切换到新的曲目。它正好是已经预读的下一首或当前曲目时，复用缓冲里的数据，开头已经不在缓冲里时从头重新解码。
+     * replayGain 是标签中的曲目增益，没有时为 NaN，解码完成后改用测得的响度
+     */
+    sink->stop();
+    ticker.stop();
+    std::shared_ptr<Stream> stream, released[3];
+    {
+        QMutexLocker lock(&mutex);
+        if (next && next->source == source) stream = next;
+        else if (current && current->source == source) stream = current;
+    }
+    if (!stream && !source.isEmpty()) stream = std::make_shared<Stream>(source);
+    qint64 decoded = 0;
+    bool restart = false;
+    {
+        QMutexLocker lock(&mutex);
+        released[0] = std::move(current);
+        released[1] = std::move(next);
+        released[2] = std::move(previous);
+        current = stream;
+        cursor = rendered = nextCursor = 0;
+        switchedAt = endedAt = fadeFrom = -1;
+        if (stream) {
+            restart = rewind(*stream, 0) || !stream->decoder;
+            decoded = stream->frames;
+            stream->tagGain = replayGain;
+            stream->scale = streamScale(*stream);
+            applied = stream->scale * gain.load();
+        }
+    }
+    if (restart) decode(stream);
+    finishing = false;
+    lastPosition = -1;
+    setPlaybackState(QMediaPlayer::StoppedState);
+    emit sourceChanged(source);
+    if (!stream) setMediaStatus(QMediaPlayer::NoMedia);
+    else setMediaStatus(decoded > 0 ? QMediaPlayer::LoadedMedia : QMediaPlayer::LoadingMedia);
+    emit durationChanged(duration());
+    emit positionChanged(0);
+}
+
+QUrl AudioEngine::source() const noexcept {
+    QMutexLocker lock(&mutex);
+    return current ? current->source : QUrl();
+}
+
+void AudioEngine::setNextSource(const QUrl& source, float replayGain) noexcept {
+    /*
+     * 预读下一首：当前曲目的数据播完后在音频线程里直接接上，中间不插入静音。这里只记下地址和增益，
+     * 距离结尾 PrerollTime 以内才开始解码（见 preroll()）。传入空地址取消预读
+     */
+    std::shared_ptr<Stream> stream, released;
+    {
+        QMutexLocker lock(&mutex);
+        if (next ? next->source == source : source.isEmpty()) return;
+    }
+    if (!source.isEmpty()) stream = std::make_shared<Stream>(source);
+    {
+        QMutexLocker lock(&mutex);
+        released = std::move(next);
+        next = stream;
+        nextCursor = 0;
+        fadeFrom = -1;
+        if (stream) {
+            stream->tagGain = replayGain;
+            stream->scale = streamScale(*stream);
+        }
+    }
+    if (!stream) finishing = false;
+    else preroll();
+}
+
+QUrl AudioEngine::nextSource() const noexcept {
+    QMutexLocker lock(&mutex);
+    return next ? next->source : QUrl();
+}
+
+qint64 AudioEngine::position() const noexcept {
+    /*
+     * 扣除设备缓冲里尚未播出的部分，得到实际听到的位置
+     */
+    const qint64 buffered = bufferedFrames();
+    QMutexLocker lock(&mutex);
+    qint64 frame = cursor - buffered;
+    if (switchedAt >= 0 && previous) frame = previous->frames - (switchedAt - (rendered - buffered));
+    else if (!current) return 0;
+    return std::max<qint64>(frame, 0) * 1000 / format.sampleRate();
+}
+
+qint64 AudioEngine::duration() const noexcept {
+    QMutexLocker lock(&mutex);
+    return current ? streamDuration(*current) : 0;
+}
+
+qint64 AudioEngine::streamDuration(const Stream& stream) const noexcept {
+    const qint64 decoded = stream.frames * 1000 / format.sampleRate();
+    return stream.complete ? decoded : std::max(stream.expected, decoded);
+}
+
+QMediaPlayer::PlaybackState AudioEngine::playbackState() const noexcept {
+    return state;
+}
+
+QMediaPlayer::MediaStatus AudioEngine::mediaStatus() const noexcept {
+    return status;
+}
+
+void AudioEngine::setVolume(float volume) noexcept {
+    gain.store(std::clamp(volume, 0.0f, 1.0f));
+}
+
+float AudioEngine::volume() const noexcept {
+    return gain.load();
+}
+
+void AudioEngine::play() noexcept {
+    std::shared_ptr<Stream> restart;
+    {
+        QMutexLocker lock(&mutex);
+        if (!current) return;
+        if (status == QMediaPlayer::EndOfMedia) {
+            cursor = nextCursor = 0;
+            if (rewind(*current, 0)) restart = current;
+        }
+    }
+    if (restart) decode(restart);
+    if (status == QMediaPlayer::EndOfMedia) setMediaStatus(QMediaPlayer::LoadedMedia);
+    if (sink->state() == QAudio::SuspendedState) sink->resume();
+    else restartOutput();
+    ticker.start();
+    setPlaybackState(QMediaPlayer::PlayingState);
+}
+
+void AudioEngine::pause() noexcept {
+    if (state != QMediaPlayer::PlayingState) return;
+    sink->suspend();
+    ticker.stop();
+    setPlaybackState(QMediaPlayer::PausedState);
+}
+
+void AudioEngine::stop() noexcept {
+    sink->stop();
+    ticker.stop();
+    settleSwitch();
+    std::shared_ptr<Stream> restart;
+    {
+        QMutexLocker lock(&mutex);
+        cursor = rendered = nextCursor = 0;
+        endedAt = fadeFrom = -1;
+        if (current && rewind(*current, 0)) restart = current;
+    }
+    if (restart) decode(restart);
+    lastPosition = -1;
+    setPlaybackState(QMediaPlayer::StoppedState);
+    emit positionChanged(0);
+}
+
+void AudioEngine::setPosition(qint64 position) noexcept {
+    /*
+     * 跳转后丢掉设备里缓冲的旧数据；新位置还没解码到时先输出静音，等解码追上。
+     * 往回跳到环形缓冲保存的范围之外时从头重新解码
+     */
+    settleSwitch();
+    std::shared_ptr<Stream> restart;
+    {
+        QMutexLocker lock(&mutex);
+        if (!current) return;
+        cursor = std::max<qint64>(position, 0) * format.sampleRate() / 1000;
+        nextCursor = 0;
+        endedAt = fadeFrom = -1;
+        if (rewind(*current, cursor)) restart = current;
+    }
+    if (restart) decode(restart);
+    if (status == QMediaPlayer::EndOfMedia) setMediaStatus(QMediaPlayer::LoadedMedia);
+    if (state == QMediaPlayer::PlayingState) restartOutput();
+    else sink->stop();
+    finishing = false;
+    lastPosition = -1;
+    emit positionChanged(position);
+}
+
+void AudioEngine::decode(const std::shared_ptr<Stream>& stream) noexcept {
+    /*
+     * 在解码线程中开始（或从头重新开始）解码。第一次解码时分配环形缓冲，容量是 BufferTime 加上交叉淡化时长，
+     * 这样曲目解码完成时结尾的淡化区间已经整个在缓冲里
+     */
+    if (!stream->decoder) {
+        {
+            QMutexLocker lock(&mutex);
+            stream->capacity = (BufferTime + fadeDuration) * format.sampleRate() / 1000;
+            stream->ring = std::make_unique<qint16[]>(stream->capacity * Channels);
+        }
+        stream->decoder = new Decoder(this, stream);
+        stream->decoder->moveToThread(&decoding);
+    }
+    Decoder* decoder = stream->decoder;
+    QMetaObject::invokeMethod(decoder, [decoder] { decoder->run(); }, Qt::QueuedConnection);
+}
+
+bool AudioEngine::rewind(Stream& stream, qint64 frame) noexcept {
+    /*
+     * 要读的位置已经被环形缓冲覆盖时，作废这一轮解码并返回 true，由调用方释放锁后调用 decode()。
+     * 往后跳不需要重新解码，解码线程会丢掉读取位置之前的数据。调用方需持有 mutex
+     */
+    if (!stream.decoder || frame >= stream.frames - stream.capacity) return false;
+    stream.generation++;
+    stream.frames = 0;
+    stream.complete = stream.stalled = false;
+    return true;
+}
+
+void AudioEngine::preroll() noexcept {
+    /*
+     * 下一首在当前曲目距离结尾 PrerollTime（加上交叉淡化时长）以内才开始解码，
+     * 同一时刻最多只有两首曲目占用缓冲。无缝切换到了还没开始解码的曲目时立即开始
+     */
+    std::shared_ptr<Stream> stream;
+    {
+        QMutexLocker lock(&mutex);
+        if (current && !current->decoder) stream = current;
+        else if (current && next && !next->decoder) {
+            const qint64 remaining = streamDuration(*current) - cursor * 1000 / format.sampleRate();
+            if (remaining <= PrerollTime + fadeDuration) stream = next;
+        }
+    }
+    if (stream) decode(stream);
+}
+
+qint64 AudioEngine::readPosition(const Stream& stream) const noexcept {
+    /*
+     * 音频线程在这首曲目中的读取位置，不再被读取的曲目返回 -1。调用方需持有 mutex
+     */
+    if (&stream == current.get()) return cursor;
+    if (&stream == next.get()) return nextCursor;
+    return -1;
+}
+
+void AudioEngine::decodingProgress(const std::weak_ptr<Stream>& stream) noexcept {
+    /*
+     * 解码线程报告了曲目时长或第一批数据，当前曲目据此更新时长和加载状态
+     */
+    const auto locked = stream.lock();
+    QMutexLocker lock(&mutex);
+    if (!locked || locked != current) return;
+    const bool loaded = locked->frames > 0;
+    lock.unlock();
+    if (loaded && status == QMediaPlayer::LoadingMedia) setMediaStatus(QMediaPlayer::LoadedMedia);
+    emit durationChanged(duration());
+}
+
+void AudioEngine::decodingFinished(const std::weak_ptr<Stream>& stream, const QString& error) noexcept {
+    /*
+     * 解码失败时已经解出的部分照常播放，一帧都没有时报告无效媒体
+     */
+    const auto locked = stream.lock();
+    if (!locked) return;
+    QMutexLocker lock(&mutex);
+    const bool playing = locked == current;
+    const bool empty = locked->frames == 0;
+    lock.unlock();
+    if (!error.isEmpty()) emit errorOccurred(error);
+    if (!playing) return;
+    if (empty && !error.isEmpty()) setMediaStatus(QMediaPlayer::InvalidMedia);
+    emit durationChanged(duration());
+}
+
+qint64 AudioEngine::render(qint16* out, qint64 frames) noexcept {
+    /*
+     * 音频设备拉取数据时调用，可能运行在音频线程中。当前曲目播完且已有下一首时，在同一个缓冲区里直接接上；
+     * 解码还没跟上时补静音。混音在浮点缓冲区中进行：先乘以音量和曲目增益，开启音量均衡时再经过限幅器，最后转回 16 位
+     */
+    QMutexLocker lock(&mutex);
+    const float volume = gain.load(std::memory_order_relaxed);
+    if (qint64(mix.size()) < frames * Channels) mix.resize(frames * Channels);
+    float* buffer = mix.data();
+    qint64 produced = 0;
+    while (produced < frames && current && endedAt < 0) {
+        const qint64 available = current->frames - cursor;
+        if (fadeFrom < 0 && fadeFrames > 0 && next && current->complete && available > 0 && available <= fadeFrames) {
+            fadeFrom = cursor;
+            fadeLength = available;
+        }
+        if (available > 0) {
+            const qint64 offset = cursor % current->capacity;
+            qint64 n = std::min({frames - produced, available, current->capacity - offset});
+            if (fadeFrom < 0 && fadeFrames > 0 && next && current->complete) n = std::min(n, available - fadeFrames);
+            const qint16* source = current->ring.get() + offset * Channels;
+            float* target = buffer + produced * Channels;
+            if (fadeFrom >= 0) n = crossfade(source, target, n, volume);
+            else {
+                /*
+                 * 增益变化（调音量、测出响度）时在约 50 毫秒内逐步靠拢，避免爆音
+                 */
+                const float wanted = current->scale * volume;
+                const float to = applied + (wanted - applied) * std::min(1.0f, float(n) / float(rampFrames));
+                AudioKernels::toFloatRamp(source, target, n, applied, to);
+                applied = to;
+            }
+            cursor += n;
+            produced += n;
+            continue;
+        }
+        if (!current->complete) break;
+        if (next) {
+            previous = std::move(current);
+            current = std::move(next);
+            cursor = nextCursor;
+            nextCursor = 0;
+            fadeFrom = -1;
+            switchedAt = rendered + produced;
+            applied = current->scale * volume;
+            continue;
+        }
+        endedAt = rendered + produced;
+    }
+    std::fill(buffer + produced * Channels, buffer + frames * Channels, 0.0f);
+    if (normalize) limiter.process(buffer, frames);
+    AudioKernels::toInt16(buffer, out, frames * Channels);
+    rendered += frames;
+    return frames;
+}
+
+qint64 AudioEngine::crossfade(const qint16* outgoing, float* target, qint64 frames, float volume) noexcept {
+    /*
+     * 在交叉淡化区间内把当前曲目的结尾和下一首的开头混在一起，返回实际混出的帧数。
+     * 增益按帧从曲线表中插值，淡出曲线是淡入曲线的镜像，两首曲目各自乘以自己的曲目增益。下一首还没解码到时只淡出当前曲目
+     */
+    const qint16* incoming = nullptr;
+    if (nextCursor < next->frames) {
+        const qint64 offset = nextCursor % next->capacity;
+        frames = std::min({frames, next->frames - nextCursor, next->capacity - offset});
+        incoming = next->ring.get() + offset * Channels;
+    }
+    const float outScale = current->scale * volume * SampleScale, inScale = next->scale * volume * SampleScale;
+    const float step = float(FadeTableSize) / float(fadeLength);
+    const float start = float(cursor - fadeFrom) * step;
+    for (qint64 i = 0; i < frames; i++) {
+        const float t = std::min(start + float(i) * step, float(FadeTableSize));
+        const float u = float(FadeTableSize) - t;
+        const int k = std::min(int(t), FadeTableSize - 1), j = std::min(int(u), FadeTableSize - 1);
+        const float in = (fadeTable[k] + (fadeTable[k + 1] - fadeTable[k]) * (t - float(k))) * inScale;
+        const float out = (fadeTable[j] + (fadeTable[j + 1] - fadeTable[j]) * (u - float(j))) * outScale;
+        for (int c = 0; c < Channels; c++) {
+            const qint64 s = i * Channels + c;
+            target[s] = float(outgoing[s]) * out + (incoming != nullptr ? float(incoming[s]) * in : 0.0f);
+        }
+    }
+    if (incoming != nullptr) nextCursor += frames;
+    applied = current->scale * volume;
+    return frames;
+}
+
+void AudioEngine::setCrossfade(qint64 milliseconds, FadeCurve curve) noexcept {
+    /*
+     * 设置交叉淡化的时长和曲线，时长为 0 时关闭。曲线预先算成查找表，混音时只做插值
+     */
+    QMutexLocker lock(&mutex);
+    fadeDuration = std::max<qint64>(milliseconds, 0);
+    fadeFrames = fadeDuration * format.sampleRate() / 1000;
+    fadeCurve = curve;
+    for (int k = 0; k <= FadeTableSize; k++) {
+        const float t = float(k) / FadeTableSize;
+        switch (curve) {
+        case Linear: fadeTable[k] = t; break;
+        case EqualPower: fadeTable[k] = std::sin(t * HalfPi); break;
+        case SCurve: fadeTable[k] = t * t * (3.0f - 2.0f * t); break;
+        }
+    }
+}
+
+void AudioEngine::setNormalization(bool enabled, float preamp) noexcept {
+    /*
+     * 开关音量均衡并设置前置增益（dB）。开启时按曲目增益调整响度，并用真峰值限幅器防止削波
+     */
+    QMutexLocker lock(&mutex);
+    if (normalize != enabled) limiter.reset();
+    normalize = enabled;
+    preampDb = preamp;
+    for (Stream* stream : {current.get(), next.get(), previous.get()}) if (stream) stream->scale = streamScale(*stream);
+    delay = enabled ? limiter.latency() : 0;
+}
+
+bool AudioEngine::normalization() const noexcept {
+    QMutexLocker lock(&mutex);
+    return normalize;
+}
+
+float AudioEngine::preamp() const noexcept {
+    QMutexLocker lock(&mutex);
+    return preampDb;
+}
+
+float AudioEngine::streamScale(const Stream& stream) const noexcept {
+    /*
+     * 标签中的增益优先，其次是解码后测得的增益，都没有时不调整。调用方需持有 mutex
+     */
+    if (!normalize) return 1.0f;
+    const float track = std::isfinite(stream.tagGain) ? stream.tagGain : std::isfinite(stream.measuredGain) ? stream.measuredGain : 0.0f;
+    return std::pow(10.0f, std::clamp(track + preampDb, -30.0f, 20.0f) / 20.0f);
+}
+
+qint64 AudioEngine::crossfadeDuration() const noexcept {
+    QMutexLocker lock(&mutex);
+    return fadeDuration;
+}
+
+AudioEngine::FadeCurve AudioEngine::crossfadeCurve() const noexcept {
+    QMutexLocker lock(&mutex);
+    return fadeCurve;
+}
+
+void AudioEngine::tick() noexcept {
+    /*
+     * 在主线程里按实际播出的进度汇报：无缝切换和播放结束都等设备缓冲里的旧数据播完才通知。
+     * 同时唤醒因缓冲写满而停下的解码，音频线程读走一半缓冲后再继续，并按进度开始预读下一首
+     */
+    const qint64 buffered = bufferedFrames();
+    std::shared_ptr<Stream> retired, stalled[2];
+    bool switched = false, ended = false, hasNext = false;
+    {
+        QMutexLocker lock(&mutex);
+        const qint64 audible = rendered - buffered;
+        if (switchedAt >= 0 && audible >= switchedAt) {
+            switchedAt = -1;
+            retired = std::move(previous);
+            switched = true;
+        }
+        if (switchedAt < 0 && endedAt >= 0 && audible >= endedAt) ended = true;
+        hasNext = next != nullptr;
+        for (int i = 0; i < 2; i++) {
+            const std::shared_ptr<Stream>& stream = i == 0 ? current : next;
+            if (!stream || !stream->stalled || stream->frames - readPosition(*stream) > stream->capacity / 2) continue;
+            stream->stalled = false;
+            stalled[i] = stream;
+        }
+    }
+    for (const auto& stream : stalled) {
+        if (!stream) continue;
+        Decoder* decoder = stream->decoder;
+        QMetaObject::invokeMethod(decoder, [decoder] { decoder->pump(); }, Qt::QueuedConnection);
+    }
+    if (switched) announceSwitch();
+    if (ended) {
+        sink->stop();
+        ticker.stop();
+        {
+            QMutexLocker lock(&mutex);
+            endedAt = -1;
+        }
+        setPlaybackState(QMediaPlayer::StoppedState);
+        setMediaStatus(QMediaPlayer::EndOfMedia);
+        return;
+    }
+    const qint64 now = position();
+    if (now != lastPosition) {
+        lastPosition = now;
+        emit positionChanged(now);
+    }
+    const qint64 length = duration();
+    if (!finishing && !hasNext && length > 0 && length - now <= PrerollTime + crossfadeDuration()) {
+        finishing = true;
+        emit aboutToFinish();
+    }
+    preroll();
+}
+
+void AudioEngine::settleSwitch() noexcept {
+    /*
+     * 跳转或停止时，尚未通知的无缝切换立即生效
+     */
+    std::shared_ptr<Stream> retired;
+    {
+        QMutexLocker lock(&mutex);
+        if (switchedAt < 0) return;
+        switchedAt = -1;
+        retired = std::move(previous);
+    }
+    announceSwitch();
+}
+
+void AudioEngine::announceSwitch() noexcept {
+    finishing = false;
+    lastPosition = -1;
+    emit sourceChanged(source());
+    emit durationChanged(duration());
+}
+
+void AudioEngine::restartOutput() noexcept {
+    sink->stop();
+    {
+        QMutexLocker lock(&mutex);
+        rendered = 0;
+        endedAt = -1;
+        limiter.reset();
+    }
+    sink->start(output.get());
+}
+
+qint64 AudioEngine::bufferedFrames() const noexcept {
+    if (sink->state() == QAudio::StoppedState) return 0;
+    return std::max<qint64>(sink->bufferSize() - sink->bytesFree(), 0) / format.bytesPerFrame() + delay.load();
+}
+
+void AudioEngine::setPlaybackState(QMediaPlayer::PlaybackState value) noexcept {
+    if (state == value) return;
+    state = value;
+    emit playbackStateChanged(value);
+}
+
+void AudioEngine::setMediaStatus(QMediaPlayer::MediaStatus value) noexcept {
+    if (status == value) return;
+    status = value;
+    emit mediaStatusChanged(value);
+}
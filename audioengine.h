@@ -0,0 +1,128 @@
+#ifndef AUDIOENGINE_H
+#define AUDIOENGINE_H
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <QObject>
+#include <QUrl>
+#include <QMutex>
+#include <QTimer>
+#include <QThread>
+#include <QAudioFormat>
+#include <QAudioDecoder>
+#include <QMediaPlayer>
+
+#include "limiter.h"
+
+class QAudioSink;
+
+class AudioEngine : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 PrerollTime = 5000;  // 距离结尾（或交叉淡化开始）多少毫秒时请求下一首并开始解码
+    static constexpr qint64 BufferTime = 10000;  // 每首曲目最多提前解码多少毫秒，另加交叉淡化的时长
+    static constexpr int FadeTableSize = 1024;
+
+    enum FadeCurve : uint8_t {
+        Linear, EqualPower, SCurve
+    };
+
+    explicit AudioEngine(QObject* parent = nullptr) noexcept;
+    ~AudioEngine();
+
+    void setSource(const QUrl& source, float replayGain = std::numeric_limits<float>::quiet_NaN()) noexcept;
+    QUrl source() const noexcept;
+    void setNextSource(const QUrl& source, float replayGain = std::numeric_limits<float>::quiet_NaN()) noexcept;
+    QUrl nextSource() const noexcept;
+    qint64 position() const noexcept;
+    qint64 duration() const noexcept;
+    QMediaPlayer::PlaybackState playbackState() const noexcept;
+    QMediaPlayer::MediaStatus mediaStatus() const noexcept;
+    void setVolume(float volume) noexcept;
+    float volume() const noexcept;
+    void setCrossfade(qint64 milliseconds, FadeCurve curve) noexcept;
+    qint64 crossfadeDuration() const noexcept;
+    FadeCurve crossfadeCurve() const noexcept;
+    void setNormalization(bool enabled, float preamp) noexcept;
+    bool normalization() const noexcept;
+    float preamp() const noexcept;
+
+public slots:
+    void play() noexcept;
+    void pause() noexcept;
+    void stop() noexcept;
+    void setPosition(qint64 position) noexcept;
+
+signals:
+    void sourceChanged(const QUrl& source);
+    void durationChanged(qint64 duration);
+    void positionChanged(qint64 position);
+    void playbackStateChanged(QMediaPlayer::PlaybackState state);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void errorOccurred(const QString& error);
+    void aboutToFinish();
+
+private:
+    struct Stream;
+    class Output;
+    class Decoder;
+
+    void decode(const std::shared_ptr<Stream>& stream) noexcept;
+    bool rewind(Stream& stream, qint64 frame) noexcept;
+    void preroll() noexcept;
+    qint64 readPosition(const Stream& stream) const noexcept;
+    void decodingProgress(const std::weak_ptr<Stream>& stream) noexcept;
+    void decodingFinished(const std::weak_ptr<Stream>& stream, const QString& error) noexcept;
+    qint64 render(qint16* out, qint64 frames) noexcept;
+    qint64 crossfade(const qint16* outgoing, float* target, qint64 frames, float volume) noexcept;
+    float streamScale(const Stream& stream) const noexcept;
+    void tick() noexcept;
+    void settleSwitch() noexcept;
+    void announceSwitch() noexcept;
+    void restartOutput() noexcept;
+    qint64 bufferedFrames() const noexcept;
+    qint64 streamDuration(const Stream& stream) const noexcept;
+    void setPlaybackState(QMediaPlayer::PlaybackState state) noexcept;
+    void setMediaStatus(QMediaPlayer::MediaStatus status) noexcept;
+
+    QAudioFormat format;
+    std::unique_ptr<Output> output;
+    std::unique_ptr<QAudioSink> sink;
+    QTimer ticker;
+    QThread decoding;  // 所有曲目的解码、格式转换和响度测量都在这个线程里进行
+
+    /*
+     * 以下成员由主线程和音频线程共享，受 mutex 保护
+     */
+    mutable QMutex mutex;
+    std::shared_ptr<Stream> current, next, previous;
+    qint64 cursor{0};           // 当前曲目中下一帧的位置
+    qint64 rendered{0};         // 输出设备启动以来交给它的总帧数
+    qint64 switchedAt{-1};      // 无缝切换发生时的 rendered，-1 表示没有待通知的切换
+    qint64 endedAt{-1};         // 播放到结尾时的 rendered
+    std::atomic<float> gain{1.0f};
+    qint64 nextCursor{0};       // 交叉淡化时下一首已经混入的帧数
+    qint64 fadeFrom{-1}, fadeLength{0};  // 正在进行的交叉淡化的起点和长度，-1 表示没有
+    qint64 fadeFrames{0}, fadeDuration{0};
+    FadeCurve fadeCurve{Linear};
+    std::array<float, FadeTableSize + 1> fadeTable{};
+    bool normalize{true};
+    float preampDb{0.0f};
+    float applied{1.0f};        // 上一帧实际使用的增益（音量乘以曲目增益），增益变化时从这里平滑过渡
+    qint64 rampFrames{1};
+    Limiter limiter;
+    std::vector<float> mix;     // 浮点混音缓冲区
+    std::atomic<int> delay{0};  // 限幅器引入的延迟帧数，关闭时为 0
+
+    QMediaPlayer::PlaybackState state{QMediaPlayer::StoppedState};
+    QMediaPlayer::MediaStatus status{QMediaPlayer::NoMedia};
+    qint64 lastPosition{-1};
+    bool finishing{false};
+};
+
+#endif // AUDIOENGINE_H
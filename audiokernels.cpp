@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIOKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define AUDIOKERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+#include "audiokernels.h"
+
+namespace {
+
+constexpr float FromInt16 = 1.0f / 32768.0f;
+constexpr float ToInt16 = 32767.0f;
+
+}
+
+void AudioKernels::toFloat(const qint16* in, float* out, qint64 count, float gain) noexcept {
+    /*
+     * 16 位整数转为 [-1, 1) 的浮点数并乘以增益
+     */
+    const float scale = gain * FromInt16;
+    qint64 i = 0;
+#if defined(AUDIOKERNELS_AVX2)
+    const __m256 factor8 = _mm256_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m256i wide = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(wide), factor8));
+    }
+#elif defined(AUDIOKERNELS_SSE2)
+    const __m128 factor = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+        const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), factor));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), factor));
+    }
+#endif
+    for (; i < count; i++) out[i] = float(in[i]) * scale;
+}
+
+void AudioKernels::toFloatRamp(const qint16* in, float* out, qint64 frames, float from, float to) noexcept {
+    /*
+     * 立体声帧转为浮点数，增益在这一段内从 from 线性过渡到 to，避免增益突变产生的爆音
+     */
+    if (from == to || frames <= 1) {
+        toFloat(in, out, frames * 2, to);
+        return;
+    }
+    const float step = (to - from) / float(frames);
+    for (qint64 i = 0; i < frames; i++) {
+        const float gain = (from + step * float(i)) * FromInt16;
+        out[i * 2] = float(in[i * 2]) * gain;
+        out[i * 2 + 1] = float(in[i * 2 + 1]) * gain;
+    }
+}
+
+void AudioKernels::toInt16(const float* in, qint16* out, qint64 count) noexcept {
+    /*
+     * 浮点数转回 16 位整数，超出范围的值饱和截断
+     */
+    qint64 i = 0;
+#if defined(AUDIOKERNELS_SSE2)
+    const __m128 factor = _mm_set1_ps(ToInt16);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), factor));
+        const __m128i high = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), factor));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(low, high));
+    }
+#endif
+    for (; i < count; i++) out[i] = qint16(std::lrint(std::clamp(in[i] * ToInt16, -32768.0f, 32767.0f)));
+}
+
+void AudioKernels::applyFrameGains(float* data, const float* gains, qint64 frames) noexcept {
+    /*
+     * 立体声数据逐帧乘以增益，两个声道共用同一个增益
+     */
+    qint64 i = 0;
+#if defined(AUDIOKERNELS_SSE2)
+    for (; i + 2 <= frames; i += 2) {
+        const __m128 g = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(gains + i)));
+        _mm_storeu_ps(data + i * 2, _mm_mul_ps(_mm_loadu_ps(data + i * 2), _mm_unpacklo_ps(g, g)));
+    }
+#endif
+    for (; i < frames; i++) {
+        data[i * 2] *= gains[i];
+        data[i * 2 + 1] *= gains[i];
+    }
+}
+
+float AudioKernels::dot(const float* a, const float* b, int count) noexcept {
+    /*
+     * 短向量点积，用于真峰值检测中的插值滤波
+     */
+    int i = 0;
+    float sum = 0.0f;
+#if defined(AUDIOKERNELS_SSE2)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#endif
+    for (; i < count; i++) sum += a[i] * b[i];
+    return sum;
+}
@@ -0,0 +1,18 @@
+#ifndef AUDIOKERNELS_H
+#define AUDIOKERNELS_H
+
+#include <QtGlobal>
+
+/*
+ * 混音和限幅用到的逐采样运算。x86 上用 SSE2（编译时开启 AVX2 则用 AVX2），其他平台用标量实现
+ */
+class AudioKernels {
+public:
+    static void toFloat(const qint16* in, float* out, qint64 count, float gain) noexcept;
+    static void toFloatRamp(const qint16* in, float* out, qint64 frames, float from, float to) noexcept;
+    static void toInt16(const float* in, qint16* out, qint64 count) noexcept;
+    static void applyFrameGains(float* data, const float* gains, qint64 frames) noexcept;
+    static float dot(const float* a, const float* b, int count) noexcept;
+};
+
+#endif // AUDIOKERNELS_H
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "audiokernels.h"
+#include "limiter.h"
+#include "loudnessmeter.h"
+
+namespace {
+
+constexpr int SampleRate = 44100;
+constexpr qint64 BlockFrames = 4096;  // 与音频输出每次处理的数据量相近
+constexpr double Pi = 3.14159265358979323846;
+
+volatile float sink;  // 保留计算结果，防止被优化掉
+
+template <typename Work>
+void measure(const char* name, qint64 frames, int rounds, Work work) noexcept {
+    /*
+     * 单线程按块处理 frames 帧立体声，重复 rounds 轮取最快的一轮，换算成每核每秒处理的采样数（两个声道各算一个）
+     */
+    double best = 1e30;
+    for (int round = 0; round < rounds; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (qint64 done = 0; done < frames; done += BlockFrames) work(std::min(BlockFrames, frames - done));
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    const double samples = double(frames) * 2;
+    std::printf("%-30s %10.1f Msamples/s  %8.0fx realtime\n", name, samples / best / 1e6, double(frames) / SampleRate / best);
+}
+
+}
+
+/*
+ * 混音、限幅和响度分析的吞吐量。用法：audio_benchmark [秒数] [轮数]，默认处理 60 秒 44.1 kHz 立体声、5 轮
+ * 输入是带噪声的正弦波，峰值超过限幅阈值，限幅器始终在工作。结果为单个核心的速度
+ */
+int main(int argc, char* argv[]) {
+    const int seconds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 60;
+    const int rounds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    const qint64 frames = qint64(seconds) * SampleRate;
+
+    std::vector<qint16> pcm(BlockFrames * 2);
+    for (qint64 i = 0; i < BlockFrames; i++) {
+        const double tone = std::sin(2 * Pi * 440.0 * double(i) / SampleRate) * 30000.0;
+        pcm[2 * i] = qint16(tone + (std::rand() % 2000 - 1000));
+        pcm[2 * i + 1] = qint16(-tone + (std::rand() % 2000 - 1000));
+    }
+    std::vector<float> samples(BlockFrames * 2), gains(BlockFrames);
+    std::vector<qint16> output(BlockFrames * 2);
+    std::fill(gains.begin(), gains.end(), 1.0f);  // 反复作用于同一块数据，增益取 1 以免数据衰减成非规格化数拖慢计时
+    AudioKernels::toFloat(pcm.data(), samples.data(), BlockFrames * 2, 1.0f);
+
+    measure("AudioKernels::toFloat", frames, rounds, [&](qint64 n) {
+        AudioKernels::toFloat(pcm.data(), samples.data(), n * 2, 0.8f);
+    });
+    measure("AudioKernels::toFloatRamp", frames, rounds, [&](qint64 n) {
+        AudioKernels::toFloatRamp(pcm.data(), samples.data(), n, 0.0f, 1.0f);
+    });
+    measure("AudioKernels::toInt16", frames, rounds, [&](qint64 n) {
+        AudioKernels::toInt16(samples.data(), output.data(), n * 2);
+    });
+    measure("AudioKernels::applyFrameGains", frames, rounds, [&](qint64 n) {
+        AudioKernels::applyFrameGains(samples.data(), gains.data(), n);
+    });
+    measure("AudioKernels::dot", frames, rounds, [&](qint64 n) {
+        sink = AudioKernels::dot(samples.data(), samples.data() + 1, int(n * 2 - 1));
+    });
+
+    Limiter limiter(SampleRate);
+    std::vector<float> loud(BlockFrames * 2);
+    AudioKernels::toFloat(pcm.data(), loud.data(), BlockFrames * 2, 1.5f);  // 放大到超过 0 dBFS
+    measure("Limiter::process", frames, rounds, [&](qint64 n) {
+        std::copy(loud.begin(), loud.begin() + n * 2, samples.begin());
+        limiter.process(samples.data(), n);
+    });
+    sink = samples[0];
+
+    LoudnessMeter meter(SampleRate);
+    measure("LoudnessMeter::process", frames, rounds, [&](qint64 n) {
+        meter.process(pcm.data(), n);
+    });
+    std::printf("integrated loudness %.1f LUFS, peak %.3f\n", meter.integratedLoudness(), double(meter.peak()));
+    return 0;
+}
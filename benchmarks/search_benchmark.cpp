@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <QAbstractTableModel>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSortFilterProxyModel>
+
+#include "searchindex.h"
+#include "stringpool.h"
+
+namespace {
+
+/*
+ * 代替 PlaylistModel 的源模型：只有行数，过滤结果按行号直接给出，与 PlaylistModel::filterAccepts 的查表方式相同
+ */
+class TrackRows : public QAbstractTableModel {
+public:
+    explicit TrackRows(int rows) noexcept : m_rows(rows) {}
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : m_rows; }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : 1; }
+    QVariant data(const QModelIndex&, int) const override { return QVariant(); }
+
+    std::vector<bool> matches;
+    bool filtering{false};
+
+private:
+    int m_rows;
+};
+
+/*
+ * 与 PlaylistFilterProxy 相同：更新过滤结果后调用 invalidateFilter，逐行询问源模型
+ */
+class FilterProxy : public QSortFilterProxyModel {
+public:
+    using QSortFilterProxyModel::QSortFilterProxyModel;
+    void refilter() { invalidateFilter(); }
+
+protected:
+    bool filterAcceptsRow(int row, const QModelIndex&) const override {
+        const TrackRows* rows = static_cast<const TrackRows*>(sourceModel());
+        return !rows->filtering || rows->matches[row];
+    }
+};
+
+QString word(std::mt19937& random, const QStringList& syllables, int count) noexcept {
+    QString text;
+    for (int i = 0; i < count; i++) text += syllables[random() % syllables.size()];
+    return text;
+}
+
+}
+
+/*
+ * 搜索框每次按键的耗时。用法：search_benchmark [曲目数] [轮数]，默认 100000 首、5 轮
+ * 用随机拼成的中英文标题、艺术家和专辑建立 SearchIndex，再逐字输入几个查询，
+ * 每个前缀依次计时 terms()、search() 和代理模型的 invalidateFilter，输出每轮的平均值。
+ * 不含 PlaylistModel 把占位行从元数据缓存取出的开销
+ */
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    const int count = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100000;
+    const int rounds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+    const QStringList latin = { "la", "mo", "ri", "sun", "ka", "ve", "to", "lin", "da", "nor", "ei", "wa" };
+    const QStringList chinese = { "晴", "天", "夜", "曲", "七", "里", "香", "稻", "花", "海", "风", "雨", "告", "白", "气", "球" };
+    std::mt19937 random(42);
+    StringPool strings;
+    std::vector<quint32> artists, albums;
+    for (int i = 0; i < std::max(1, count / 20); i++) {
+        artists.push_back(strings.intern(i % 3 ? word(random, latin, 3) : word(random, chinese, 3)));
+    }
+    for (int i = 0; i < std::max(1, count / 10); i++) {
+        albums.push_back(strings.intern(i % 3 ? word(random, latin, 4) : word(random, chinese, 4)));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    SearchIndex index(strings);
+    for (int id = 0; id < count; id++) {
+        const QString title = id % 3 ? word(random, latin, 2) + " " + word(random, latin, 3) : word(random, chinese, 4);
+        index.insert(quint32(id), title, artists[random() % artists.size()], albums[random() % albums.size()]);
+    }
+    std::printf("%d tracks indexed in %.1f ms\n", count, double(timer.nsecsElapsed()) / 1e6);
+
+    TrackRows rows(count);
+    FilterProxy proxy;
+    proxy.setSourceModel(&rows);
+
+    const QStringList queries = { "sunla", "lin da", "晴天", "七里香" };
+    qint64 termsTime = 0, searchTime = 0, filterTime = 0;
+    int keystrokes = 0, visible = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (const QString& query : queries) {
+            for (int length = 1; length <= query.size(); length++) {
+                timer.restart();
+                const QStringList terms = SearchIndex::terms(query.left(length));
+                termsTime += timer.nsecsElapsed();
+                timer.restart();
+                rows.matches = index.search(terms);
+                rows.matches.resize(count, false);
+                rows.filtering = !terms.isEmpty();
+                searchTime += timer.nsecsElapsed();
+                timer.restart();
+                proxy.refilter();
+                visible = proxy.rowCount();
+                filterTime += timer.nsecsElapsed();
+                keystrokes++;
+            }
+            rows.filtering = false;
+            proxy.refilter();
+        }
+    }
+
+    const auto perKey = [keystrokes](qint64 nanoseconds) { return double(nanoseconds) / 1e3 / keystrokes; };
+    std::printf("%d keystrokes, last query shows %d rows\n", keystrokes / rounds, visible);
+    std::printf("terms()           %10.1f us/keystroke\n", perKey(termsTime));
+    std::printf("search()          %10.1f us/keystroke\n", perKey(searchTime));
+    std::printf("invalidateFilter  %10.1f us/keystroke\n", perKey(filterTime));
+    std::printf("total             %10.1f us/keystroke\n", perKey(termsTime + searchTime + filterTime));
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "transitiongraph.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::duration duration) noexcept {
+    return std::chrono::duration<double>(duration).count();
+}
+
+}
+
+/*
+ * 转移图的更新和推荐耗时。用法：transition_benchmark [曲目数] [播放次数]，默认 100000 首、5000000 次
+ * 模拟长期收听：曲目热度按 Zipf 分布，一半的下一首取自 next() 的推荐，其余随机挑选；
+ * 六成听完，其余分别在开头或中途跳过。分别统计 played + finished（更新）和 next（查询）每次的平均耗时
+ */
+int main(int argc, char* argv[]) {
+    const quint32 tracks = argc > 1 ? quint32(std::max(1, std::atoi(argv[1]))) : 100000;
+    const qint64 events = argc > 2 ? std::max(1LL, std::atoll(argv[2])) : 5000000;
+
+    std::mt19937 random(42);
+    std::vector<double> weights(tracks);
+    for (quint32 i = 0; i < tracks; i++) weights[i] = 1.0 / std::pow(double(i + 1), 0.8);
+    std::discrete_distribution<quint32> popular(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> percent(0, 99);
+    const auto accept = [](quint32 id) { return id % 7 != 0; };  // 相当于过滤掉一部分曲目
+
+    TransitionGraph graph;
+    Clock::duration updateTime{}, queryTime{};
+    qint64 recommended = 0;
+    quint32 current = popular(random);
+    for (qint64 event = 0; event < events; event++) {
+        const int outcome = percent(random);
+        const bool completed = outcome < 60;
+        const qint64 position = completed ? 240000 : outcome < 80 ? 5000 : 120000;
+        auto start = Clock::now();
+        graph.played(current);
+        graph.finished(current, completed, position);
+        updateTime += Clock::now() - start;
+
+        start = Clock::now();
+        const quint32 next = graph.next(accept);
+        queryTime += Clock::now() - start;
+        if (next != TransitionGraph::None && percent(random) < 50) {
+            current = next;
+            recommended++;
+        }
+        else current = popular(random);
+    }
+
+    std::printf("%u tracks, %lld events, %.1f%% followed a recommendation\n", tracks, static_cast<long long>(events), 100.0 * double(recommended) / double(events));
+    std::printf("played + finished  %8.1f ns/event  %8.2f M events/s\n", seconds(updateTime) * 1e9 / double(events), double(events) / seconds(updateTime) / 1e6);
+    std::printf("next               %8.1f ns/query  %8.2f M queries/s\n", seconds(queryTime) * 1e9 / double(events), double(events) / seconds(queryTime) / 1e6);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+
+#include "coverresolver.h"
+
+CoverResolver::CoverResolver(QObject* parent) noexcept : QObject(parent) {
+    /*
+     * 查找和解码封面都在后台线程进行，网络目录再慢也不会卡住界面
+     */
+    pool.setMaxThreadCount(2);
+}
+
+CoverResolver::~CoverResolver() {
+    pool.clear();
+    pool.waitForDone();
+}
+
+quint64 CoverResolver::resolve(const QString& embeddedPath, const QString& trackPath, const QString& album, const QSize& size) noexcept {
+    /*
+     * 异步获取封面并缩放到 size 以内，结果通过 resolved 信号返回。只有最新一次请求的结果会被送达
+     */
+    const quint64 request = ++lastRequest;
+    pool.start([this, request, embeddedPath, trackPath, album, size] {
+        if (request != lastRequest.load()) return;
+        const QImage image = load(embeddedPath, trackPath, album, size);
+        QMetaObject::invokeMethod(this, [this, request, image] {
+            if (request == lastRequest.load()) emit resolved(request, image);
+        }, Qt::QueuedConnection);
+    });
+    return request;
+}
+
+QStringList CoverResolver::imagesIn(const QString& directory) noexcept {
+    /*
+     * 列出目录中的图片文件，结果按目录缓存，没有图片的目录同样缓存为空列表。
+     * 每次使用缓存前先比较目录的修改时间，运行中新放进去的 cover.jpg 也能找到，代价只是一次 stat
+     */
+    const qint64 mtime = QFileInfo(directory).lastModified().toMSecsSinceEpoch();
+    {
+        QMutexLocker locker(&mutex);
+        const Listing* cached = directoryImages.object(directory);
+        if (cached != nullptr && cached->mtime == mtime) return cached->images;
+    }
+    static const QStringList filters = { "*.jpg", "*.jpeg", "*.png", "*.webp", "*.bmp" };
+    const QStringList images = QDir(directory).entryList(filters, QDir::Files | QDir::Readable, QDir::Name);
+    QMutexLocker locker(&mutex);
+    directoryImages.insert(directory, new Listing{images, mtime});
+    return images;
+}
+
+QImage CoverResolver::load(const QString& embeddedPath, const QString& trackPath, const QString& album, const QSize& size) noexcept {
+    /*
+     * 依次尝试：内嵌封面、目录中的 cover/folder/front/album 等常见文件名、与专辑同名的图片、
+     * Windows Media Player 留下的 AlbumArt*（如 AlbumArt_{GUID}_Large.jpg，大图优先、小图最后），
+     * 最后如果目录里只有一张图片就用它。解码时直接缩放到目标尺寸
+     */
+    auto read = [&size](const QString& path) {
+        QImageReader reader(path);
+        const QSize original = reader.size();
+        if (size.isValid() && original.isValid() && (original.width() > size.width() || original.height() > size.height()))
+            reader.setScaledSize(original.scaled(size, Qt::KeepAspectRatio));
+        return reader.read();
+    };
+    if (!embeddedPath.isEmpty()) {
+        const QImage image = read(embeddedPath);
+        if (!image.isNull()) return image;
+    }
+    const QString directory = QFileInfo(trackPath).absolutePath();
+    const QStringList images = imagesIn(directory);
+    if (images.isEmpty()) return QImage();
+    QStringList names = { "cover", "folder", "front", "album" };
+    if (!album.isEmpty()) names << album.toLower();
+    for (const QString& name : names) for (const QString& image : images) {
+        if (QFileInfo(image).completeBaseName().toLower() != name) continue;
+        const QImage result = read(directory + "/" + image);
+        if (!result.isNull()) return result;
+    }
+    QStringList albumArt;
+    for (const QString& image : images) if (image.startsWith("albumart", Qt::CaseInsensitive)) albumArt << image;
+    std::stable_sort(albumArt.begin(), albumArt.end(), [](const QString& a, const QString& b) {
+        const auto rank = [](const QString& name) { return name.contains("large", Qt::CaseInsensitive) ? 0 : name.contains("small", Qt::CaseInsensitive) ? 2 : 1; };
+        return rank(a) < rank(b);
+    });
+    for (const QString& image : albumArt) {
+        const QImage result = read(directory + "/" + image);
+        if (!result.isNull()) return result;
+    }
+    if (images.size() == 1) return read(directory + "/" + images.first());
+    return QImage();
+}
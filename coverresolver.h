@@ -0,0 +1,42 @@
+#ifndef COVERRESOLVER_H
+#define COVERRESOLVER_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QImage>
+#include <QStringList>
+#include <QThreadPool>
+
+class CoverResolver : public QObject {
+    Q_OBJECT
+
+public:
+    explicit CoverResolver(QObject* parent = nullptr) noexcept;
+    ~CoverResolver();
+
+    static constexpr int CachedDirectories = 256;  // 最多缓存多少个目录的图片列表，超出时淘汰最久未用的
+
+    quint64 resolve(const QString& embeddedPath, const QString& trackPath, const QString& album, const QSize& size) noexcept;
+
+signals:
+    void resolved(quint64 request, const QImage& image);
+
+private:
+    struct Listing {
+        QStringList images;
+        qint64 mtime;  // 列出时目录的修改时间，目录中增删文件后随之变化
+    };
+
+    QImage load(const QString& embeddedPath, const QString& trackPath, const QString& album, const QSize& size) noexcept;
+    QStringList imagesIn(const QString& directory) noexcept;
+
+    QThreadPool pool;
+    QMutex mutex;
+    QCache<QString, Listing> directoryImages{CachedDirectories};
+    std::atomic<quint64> lastRequest{0};
+};
+
+#endif // COVERRESOLVER_H
@@ -0,0 +1,99 @@
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QSaveFile>
+#include <QImageReader>
+#include <QCryptographicHash>
+
+#include <climits>
+
+#include "coverstore.h"
+
+CoverStore::CoverStore(const QString& directory) noexcept : m_directory(directory) {
+    setMemoryBudget(16 * 1024 * 1024);
+}
+
+void CoverStore::setDirectory(const QString& directory) noexcept {
+    /*
+     * 应在开始读取元数据之前设置，工作线程只读取该值
+     */
+    m_directory = directory;
+    m_thumbnails.clear();
+}
+
+QString CoverStore::directory() const noexcept {
+    return m_directory;
+}
+
+void CoverStore::setMemoryBudget(qint64 bytes) noexcept {
+    /*
+     * 缩略图缓存以 KB 计费，超出预算时按最近最少使用的顺序淘汰
+     */
+    m_thumbnails.setMaxCost(int(qBound<qint64>(1, bytes / 1024, INT_MAX)));
+}
+
+qint64 CoverStore::memoryBudget() const noexcept {
+    return qint64(m_thumbnails.maxCost()) * 1024;
+}
+
+QString CoverStore::insert(const QByteArray& data) const noexcept {
+    /*
+     * 以原始字节的哈希为键保存封面，同一专辑的相同封面只保存一份。不解码图片，可在工作线程中调用
+     */
+    if (data.isEmpty() || m_directory.isEmpty()) return QString();
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    if (QImageReader::imageFormat(&buffer).isEmpty()) return QString();
+    const QString key = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    const QString path = m_directory + "/" + key;
+    if (QFile::exists(path)) return key;
+    QDir{}.mkpath(m_directory);
+    QSaveFile file{path};
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) return QString();
+    return key;
+}
+
+QString CoverStore::insert(const QImage& image) const noexcept {
+    /*
+     * 只拿到解码后图片时（QMediaPlayer 回退路径），先编码为 JPEG 再保存
+     */
+    if (image.isNull()) return QString();
+    QByteArray data;
+    QBuffer buffer{&data};
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPG", 90)) return QString();
+    return insert(data);
+}
+
+QImage CoverStore::thumbnail(const QString& key) noexcept {
+    /*
+     * 返回缩略图，未命中时从磁盘按缩略图尺寸解码并放入 LRU 缓存
+     */
+    if (key.isEmpty()) return QImage();
+    if (const QImage* cached = m_thumbnails.object(key)) return *cached;
+    const QImage thumb = image(key, QSize(ThumbnailSize, ThumbnailSize));
+    if (thumb.isNull()) return thumb;
+    m_thumbnails.insert(key, new QImage(thumb), qMax<int>(1, int(thumb.sizeInBytes() / 1024)));
+    return thumb;
+}
+
+QString CoverStore::path(const QString& key) const noexcept {
+    /*
+     * 返回封面文件的路径，没有封面时返回空字符串
+     */
+    if (key.isEmpty()) return QString();
+    return m_directory + "/" + key;
+}
+
+QImage CoverStore::image(const QString& key, const QSize& bound) const noexcept {
+    /*
+     * 从磁盘解码封面，不做缓存。给出 bound 时在解码阶段直接缩小到该尺寸以内
+     */
+    if (key.isEmpty()) return QImage();
+    QImageReader reader(path(key));
+    const QSize size = reader.size();
+    if (bound.isValid() && size.isValid() && (size.width() > bound.width() || size.height() > bound.height()))
+        reader.setScaledSize(size.scaled(bound, Qt::KeepAspectRatio));
+    return reader.read();
+}
@@ -0,0 +1,34 @@
+#ifndef COVERSTORE_H
+#define COVERSTORE_H
+
+#include <QCache>
+#include <QImage>
+#include <QString>
+
+class CoverStore {
+public:
+    /*
+     * 缩略图的最大边长，用于托盘通知等小尺寸显示
+     */
+    static constexpr int ThumbnailSize = 96;
+
+    explicit CoverStore(const QString& directory = QString()) noexcept;
+
+    void setDirectory(const QString& directory) noexcept;
+    QString directory() const noexcept;
+    void setMemoryBudget(qint64 bytes) noexcept;
+    qint64 memoryBudget() const noexcept;
+
+    QString insert(const QByteArray& data) const noexcept;
+    QString insert(const QImage& image) const noexcept;
+
+    QImage thumbnail(const QString& key) noexcept;
+    QImage image(const QString& key, const QSize& bound = QSize()) const noexcept;
+    QString path(const QString& key) const noexcept;
+
+private:
+    QString m_directory;
+    QCache<QString, QImage> m_thumbnails;
+};
+
+#endif // COVERSTORE_H
@@ -0,0 +1,127 @@
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "folderscanner.h"
+
+FolderScanner::FolderScanner(QObject* parent) noexcept : QObject(parent) {
+    /*
+     * 工作线程负责遍历目录，主线程每 100 毫秒把新发现的文件成批交给播放列表
+     */
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    flushTimer.setInterval(100);
+    connect(&flushTimer, &QTimer::timeout, this, &FolderScanner::flush);
+}
+
+FolderScanner::~FolderScanner() {
+    cancel();
+    pool.waitForDone();
+}
+
+void FolderScanner::setSuffixes(const QStringList& list) noexcept {
+    suffixes.clear();
+    for (const QString& suffix : list) suffixes.insert(suffix.toLower());
+}
+
+void FolderScanner::scan(const QString& root) noexcept {
+    /*
+     * 递归扫描一个目录。扫描进行中也可以继续添加目录，它们共享同一份已访问集合
+     */
+    if (!isBusy()) {
+        QMutexLocker locker(&mutex);
+        visited.clear();
+        pending.clear();
+        directoryCount = fileCount = 0;
+    }
+    flushTimer.start();
+    submit(root, generation.load());
+}
+
+void FolderScanner::cancel() noexcept {
+    /*
+     * 停止扫描：丢弃排队中的目录和尚未交付的文件，正在运行的任务会在下一个目录项处退出
+     */
+    bool wasBusy;
+    {
+        QMutexLocker locker(&mutex);
+        generation++;
+        wasBusy = activeTasks.exchange(0) > 0;
+        pending.clear();
+    }
+    pool.clear();
+    flushTimer.stop();
+    if (wasBusy) emit finished();
+}
+
+bool FolderScanner::isBusy() const noexcept {
+    return activeTasks.load() > 0;
+}
+
+void FolderScanner::submit(const QString& directory, quint64 gen) noexcept {
+    /*
+     * 计数与取消在同一把锁下进行，已取消的扫描不会再提交新任务
+     */
+    {
+        QMutexLocker locker(&mutex);
+        if (gen != generation.load()) return;
+        activeTasks++;
+    }
+    pool.start([this, directory, gen] {
+        walk(directory, gen);
+        QMetaObject::invokeMethod(this, [this, gen] { taskDone(gen); }, Qt::QueuedConnection);
+    });
+}
+
+void FolderScanner::walk(const QString& directory, quint64 gen) noexcept {
+    /*
+     * 在工作线程中列出一个目录：子目录作为新任务提交，支持格式的文件放入待交付列表。
+     * 目录按规范路径去重，符号链接形成的环只会被访问一次
+     */
+    if (generation.load() != gen) return;
+    const QString canonical = QFileInfo(directory).canonicalFilePath();
+    if (canonical.isEmpty()) return;
+    {
+        QMutexLocker locker(&mutex);
+        if (visited.contains(canonical)) return;
+        visited.insert(canonical);
+    }
+    QStringList files;
+    QDirIterator it(canonical, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+    while (it.hasNext()) {
+        if (generation.load() != gen) return;
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) submit(info.absoluteFilePath(), gen);
+        else if (suffixes.contains(info.suffix().toLower())) files << info.absoluteFilePath();
+    }
+    directoryCount++;
+    fileCount += files.size();
+    if (files.isEmpty()) return;
+    QMutexLocker locker(&mutex);
+    if (generation.load() == gen) pending << files;
+}
+
+void FolderScanner::flush() noexcept {
+    /*
+     * 在主线程中交付已发现的文件并报告进度
+     */
+    QStringList batch;
+    {
+        QMutexLocker locker(&mutex);
+        batch.swap(pending);
+    }
+    if (!batch.isEmpty()) emit filesFound(batch);
+    emit progressChanged(directoryCount.load(), fileCount.load());
+}
+
+void FolderScanner::taskDone(quint64 gen) noexcept {
+    /*
+     * 最后一个目录任务结束时交付剩余文件并发出 finished
+     */
+    if (gen != generation.load()) return;
+    if (--activeTasks > 0) return;
+    flushTimer.stop();
+    flush();
+    emit finished();
+}
@@ -0,0 +1,48 @@
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <atomic>
+
+#include <QObject>
+#include <QSet>
+#include <QMutex>
+#include <QTimer>
+#include <QStringList>
+#include <QThreadPool>
+
+class FolderScanner : public QObject {
+    Q_OBJECT
+
+public:
+    explicit FolderScanner(QObject* parent = nullptr) noexcept;
+    ~FolderScanner();
+
+    void setSuffixes(const QStringList& suffixes) noexcept;
+    void scan(const QString& root) noexcept;
+    void cancel() noexcept;
+    bool isBusy() const noexcept;
+
+signals:
+    void filesFound(const QStringList& files);
+    void progressChanged(int directories, int files);
+    void finished();
+
+private:
+    void walk(const QString& directory, quint64 generation) noexcept;
+    void submit(const QString& directory, quint64 generation) noexcept;
+    void flush() noexcept;
+    void taskDone(quint64 generation) noexcept;
+
+    QThreadPool pool;
+    QTimer flushTimer;
+    QSet<QString> suffixes;
+
+    QMutex mutex;
+    QSet<QString> visited;
+    QStringList pending;
+
+    std::atomic<quint64> generation{0};
+    std::atomic<int> activeTasks{0}, directoryCount{0}, fileCount{0};
+};
+
+#endif // FOLDERSCANNER_H
@@ -0,0 +1,169 @@
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+
+#include "librarywatcher.h"
+
+LibraryWatcher::LibraryWatcher(QObject* parent) noexcept : QObject(parent) {
+    /*
+     * 文件系统通知先累积到脏目录集合，1.5 秒内的变化合并成一批处理；另有每 5 分钟一次的全量比对，弥补通知丢失的情况
+     */
+    pool.setMaxThreadCount(1);
+    batchTimer.setSingleShot(true);
+    batchTimer.setInterval(1500);
+    periodicTimer.setInterval(5 * 60 * 1000);
+    connect(&batchTimer, &QTimer::timeout, this, &LibraryWatcher::reconcile);
+    connect(&periodicTimer, &QTimer::timeout, this, &LibraryWatcher::rescan);
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryWatcher::markDirty);
+}
+
+LibraryWatcher::~LibraryWatcher() {
+    pool.waitForDone();
+}
+
+void LibraryWatcher::setEnabled(bool value) noexcept {
+    /*
+     * 开启时监视所有相关目录并立即做一次全量比对，关闭时移除全部监视
+     */
+    if (enabled == value) return;
+    enabled = value;
+    if (enabled) {
+        setDirectories(directories);
+        periodicTimer.start();
+        rescan();
+    }
+    else {
+        const QStringList watched = watcher.directories();
+        if (!watched.isEmpty()) watcher.removePaths(watched);
+        periodicTimer.stop();
+        batchTimer.stop();
+        dirty.clear();
+    }
+}
+
+bool LibraryWatcher::isEnabled() const noexcept {
+    return enabled;
+}
+
+void LibraryWatcher::setSnapshot(const Snapshot& value) noexcept {
+    snapshot = value;
+}
+
+void LibraryWatcher::setSuffixes(const QStringList& list) noexcept {
+    suffixes.clear();
+    for (const QString& suffix : list) suffixes.insert(suffix.toLower());
+}
+
+void LibraryWatcher::setRoots(const QStringList& list) noexcept {
+    roots = list;
+    setDirectories(directories);
+}
+
+bool LibraryWatcher::underRoot(const QString& path) const noexcept {
+    for (const QString& root : roots) if (path == root || path.startsWith(root + "/")) return true;
+    return false;
+}
+
+void LibraryWatcher::setDirectories(const QSet<QString>& trackDirectories) noexcept {
+    /*
+     * 监视曲目所在目录、导入的根目录，以及两者之间的各级目录，这样新建的专辑文件夹也能被发现
+     */
+    QSet<QString> wanted;
+    for (const QString& root : roots) wanted.insert(root);
+    for (const QString& directory : trackDirectories) {
+        wanted.insert(directory);
+        if (!underRoot(directory)) continue;
+        for (QString parent = directory; !roots.contains(parent);) {
+            const int slash = parent.lastIndexOf('/');
+            if (slash <= 0) break;
+            parent.truncate(slash);
+            wanted.insert(parent);
+        }
+    }
+    directories = wanted;
+    if (!enabled) return;
+    const QStringList watched = watcher.directories();
+    const QSet<QString> current(watched.cbegin(), watched.cend());
+    QStringList removed, added;
+    for (const QString& directory : current) if (!wanted.contains(directory)) removed << directory;
+    for (const QString& directory : wanted) if (!current.contains(directory)) added << directory;
+    if (!removed.isEmpty()) watcher.removePaths(removed);
+    if (!added.isEmpty()) watcher.addPaths(added);
+}
+
+void LibraryWatcher::rescan() noexcept {
+    /*
+     * 定期全量比对：把所有相关目录都标记为脏
+     */
+    if (!enabled) return;
+    dirty.unite(directories);
+    batchTimer.start(0);
+}
+
+void LibraryWatcher::markDirty(const QString& directory) noexcept {
+    dirty.insert(directory);
+    if (!batchTimer.isActive()) batchTimer.start();
+}
+
+void LibraryWatcher::reconcile() noexcept {
+    /*
+     * 取出一批脏目录，在后台线程中列出目录并与播放列表的快照比对，只把差异交回主线程。
+     * 上一批尚未完成时不启动新一批，新的变化留到下一批
+     */
+    if (!enabled || dirty.isEmpty() || !snapshot) return;
+    if (running) {
+        batchTimer.start();
+        return;
+    }
+    running = true;
+    const QSet<QString> batch = dirty;
+    dirty.clear();
+    const QList<FileState> known = snapshot(batch);
+    pool.start([this, batch, known, watched = directories, rootList = roots, suffixList = suffixes] {
+        const Delta delta = compare(batch, known, watched, rootList, suffixList);
+        QMetaObject::invokeMethod(this, [this, delta] {
+            running = false;
+            if (enabled && (!delta.added.isEmpty() || !delta.removed.isEmpty() || !delta.changed.isEmpty() || !delta.directories.isEmpty()))
+                emit changesDetected(delta);
+            if (!dirty.isEmpty() && !batchTimer.isActive()) batchTimer.start();
+        }, Qt::QueuedConnection);
+    });
+}
+
+LibraryWatcher::Delta LibraryWatcher::compare(const QSet<QString>& batch, const QList<FileState>& known, const QSet<QString>& watched,
+                                              const QStringList& roots, const QSet<QString>& suffixes) noexcept {
+    /*
+     * 在工作线程中运行：消失的文件记为删除，大小或修改时间变化的记为修改，
+     * 导入根目录下新出现的文件记为新增，新出现的子目录交给文件夹扫描器
+     */
+    auto underRoot = [&roots](const QString& path) {
+        for (const QString& root : roots) if (path == root || path.startsWith(root + "/")) return true;
+        return false;
+    };
+    QHash<QString, const FileState*> byPath;
+    byPath.reserve(known.size());
+    for (const FileState& state : known) byPath.insert(state.path, &state);
+    Delta delta;
+    QSet<QString> seen;
+    for (const QString& directory : batch) {
+        const bool inRoot = underRoot(directory);
+        const QFileInfoList entries = QDir(directory).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+        for (const QFileInfo& info : entries) {
+            const QString path = info.absoluteFilePath();
+            if (info.isDir()) {
+                if (inRoot && !watched.contains(path)) delta.directories << path;
+                continue;
+            }
+            if (!suffixes.contains(info.suffix().toLower())) continue;
+            const auto it = byPath.constFind(path);
+            if (it == byPath.cend()) {
+                if (inRoot) delta.added << path;
+                continue;
+            }
+            seen.insert(path);
+            if ((*it)->mtime != 0 && ((*it)->size != info.size() || (*it)->mtime != info.lastModified().toMSecsSinceEpoch())) delta.changed << path;
+        }
+    }
+    for (const FileState& state : known) if (!seen.contains(state.path)) delta.removed << state.path;
+    return delta;
+}
@@ -0,0 +1,58 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <functional>
+
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
+
+class LibraryWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    struct FileState {
+        QString path;
+        qint64 size, mtime;
+    };
+
+    struct Delta {
+        QStringList added, removed, changed, directories;
+    };
+
+    using Snapshot = std::function<QList<FileState>(const QSet<QString>& directories)>;
+
+    explicit LibraryWatcher(QObject* parent = nullptr) noexcept;
+    ~LibraryWatcher();
+
+    void setEnabled(bool enabled) noexcept;
+    bool isEnabled() const noexcept;
+    void setSnapshot(const Snapshot& snapshot) noexcept;
+    void setSuffixes(const QStringList& suffixes) noexcept;
+    void setRoots(const QStringList& roots) noexcept;
+    void setDirectories(const QSet<QString>& trackDirectories) noexcept;
+    void rescan() noexcept;
+
+signals:
+    void changesDetected(const LibraryWatcher::Delta& delta);
+
+private:
+    void markDirty(const QString& directory) noexcept;
+    void reconcile() noexcept;
+    bool underRoot(const QString& path) const noexcept;
+    static Delta compare(const QSet<QString>& directories, const QList<FileState>& known, const QSet<QString>& watched,
+                         const QStringList& roots, const QSet<QString>& suffixes) noexcept;
+
+    QFileSystemWatcher watcher;
+    QTimer batchTimer, periodicTimer;
+    QThreadPool pool;
+    Snapshot snapshot;
+    QSet<QString> suffixes, directories, dirty;
+    QStringList roots;
+    bool enabled{false}, running{false};
+};
+
+#endif // LIBRARYWATCHER_H
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+
+#include "limiter.h"
+#include "audiokernels.h"
+
+Limiter::Limiter(int sampleRate) noexcept {
+    setSampleRate(sampleRate);
+}
+
+void Limiter::setSampleRate(int sampleRate) noexcept {
+    /*
+     * 前瞻 1.5 毫秒，释放时间常数 80 毫秒。插值滤波器是加 Hann 窗的 sinc，按 4 倍过采样拆成 3 个非整点相位
+     */
+    m_lookahead = std::max(16, sampleRate * 3 / 2000);
+    m_release = 1.0f - std::exp(-1.0f / (0.08f * float(sampleRate)));
+    constexpr int Length = Taps * 4;
+    constexpr double Pi = 3.14159265358979323846;
+    std::array<float, Length> h{};
+    for (int n = 0; n < Length; n++) {
+        const double x = double(n - Length / 2) / 4.0;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(Pi * x) / (Pi * x);
+        const double window = 0.5 - 0.5 * std::cos(2.0 * Pi * n / Length);
+        h[n] = float(sinc * window);
+    }
+    for (int p = 1; p <= 3; p++) for (int m = 0; m < Taps; m++) m_phases[p - 1][m] = h[4 * (Taps - 1 - m) + p];
+    reset();
+}
+
+void Limiter::setCeiling(float ceiling) noexcept {
+    m_ceiling = std::clamp(ceiling, 0.1f, 1.0f);
+}
+
+void Limiter::reset() noexcept {
+    for (std::vector<float>& history : m_history) history.assign(Taps - 1, 0.0f);
+    for (std::vector<float>& delay : m_delay) delay.assign(latency(), 0.0f);
+    m_holdValues.assign(m_lookahead + 1, 1.0f);
+    m_holdIndex.assign(m_lookahead + 1, 0);
+    m_boxValues.assign(m_lookahead, 1.0f);
+    m_holdHead = m_holdSize = m_boxPos = m_delayPos = 0;
+    m_frame = 0;
+    m_boxSum = m_lookahead;
+    m_gain = 1.0f;
+}
+
+int Limiter::latency() const noexcept {
+    return Taps / 2 + m_lookahead - 1;
+}
+
+float Limiter::detect(const float* window) const noexcept {
+    /*
+     * window 是某个声道最近 Taps 个采样，返回 Taps / 2 帧之前那个采样点及其后三个插值点的最大绝对值
+     */
+    float peak = std::fabs(window[Taps / 2 - 1]);
+    for (const std::array<float, Taps>& phase : m_phases) peak = std::max(peak, std::fabs(AudioKernels::dot(window, phase.data(), Taps)));
+    return peak;
+}
+
+void Limiter::process(float* data, qint64 frames) noexcept {
+    /*
+     * 原地处理一段交错立体声。每帧算出压到上限所需的增益，在前瞻窗口内取最小值，
+     * 释放阶段按指数回升，再做一次与前瞻等长的滑动平均，保证增益在峰值到达前已经降到位
+     */
+    if (frames <= 0) return;
+    const qint64 stride = Taps - 1 + frames;
+    m_work.resize(stride * 2);
+    for (int c = 0; c < 2; c++) {
+        float* work = m_work.data() + c * stride;
+        std::copy(m_history[c].cbegin(), m_history[c].cend(), work);
+        for (qint64 i = 0; i < frames; i++) work[Taps - 1 + i] = data[i * 2 + c];
+        std::copy(work + frames, work + frames + Taps - 1, m_history[c].begin());
+    }
+    m_gains.resize(frames);
+    const int capacity = m_lookahead + 1;
+    for (qint64 i = 0; i < frames; i++) {
+        const float level = std::max(detect(m_work.data() + i), detect(m_work.data() + stride + i));
+        const float required = level > m_ceiling ? m_ceiling / level : 1.0f;
+        while (m_holdSize > 0 && m_holdValues[(m_holdHead + m_holdSize - 1) % capacity] >= required) m_holdSize--;
+        const int back = (m_holdHead + m_holdSize) % capacity;
+        m_holdValues[back] = required;
+        m_holdIndex[back] = int(m_frame % capacity);
+        m_holdSize++;
+        if ((m_frame - m_holdIndex[m_holdHead] + capacity) % capacity >= m_lookahead) {
+            m_holdHead = (m_holdHead + 1) % capacity;
+            m_holdSize--;
+        }
+        m_gain = std::min(m_holdValues[m_holdHead], m_gain + (1.0f - m_gain) * m_release);
+        m_boxSum += m_gain - m_boxValues[m_boxPos];
+        m_boxValues[m_boxPos] = m_gain;
+        m_boxPos = (m_boxPos + 1) % m_lookahead;
+        m_gains[i] = float(m_boxSum / m_lookahead);
+        m_frame++;
+    }
+    const int delay = latency();
+    for (qint64 i = 0; i < frames; i++) {
+        for (int c = 0; c < 2; c++) {
+            float& slot = m_delay[c][m_delayPos];
+            const float input = m_work[c * stride + Taps - 1 + i];
+            data[i * 2 + c] = slot;
+            slot = input;
+        }
+        m_delayPos = (m_delayPos + 1) % delay;
+    }
+    AudioKernels::applyFrameGains(data, m_gains.data(), frames);
+}
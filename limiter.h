@@ -0,0 +1,43 @@
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <array>
+#include <vector>
+
+#include <QtGlobal>
+
+/*
+ * 立体声前瞻真峰值限幅器：4 倍过采样估计采样点之间的峰值，前瞻窗口内取最小增益再平滑，输出延迟 latency() 帧
+ */
+class Limiter {
+public:
+    static constexpr int Taps = 12;  // 每个插值相位的滤波器长度
+
+    explicit Limiter(int sampleRate = 44100) noexcept;
+
+    void setSampleRate(int sampleRate) noexcept;
+    void setCeiling(float ceiling) noexcept;
+    void reset() noexcept;
+    void process(float* data, qint64 frames) noexcept;
+    int latency() const noexcept;
+
+private:
+    float detect(const float* window) const noexcept;
+
+    std::array<std::array<float, Taps>, 3> m_phases{};
+    float m_ceiling{0.891f};  // -1 dBTP
+    float m_release{0.0f};
+    int m_lookahead{64};
+
+    std::array<std::vector<float>, 2> m_history;  // 每个声道最近 Taps - 1 个输入，供插值滤波使用
+    std::array<std::vector<float>, 2> m_delay;    // 等待增益的音频
+    std::vector<float> m_holdValues, m_boxValues, m_gains;
+    std::vector<int> m_holdIndex;
+    std::vector<float> m_work;
+    int m_holdHead{0}, m_holdSize{0}, m_boxPos{0}, m_delayPos{0};
+    qint64 m_frame{0};
+    double m_boxSum{0.0};
+    float m_gain{1.0f};
+};
+
+#endif // LIMITER_H
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "loudnessmeter.h"
+
+LoudnessMeter::LoudnessMeter(int sampleRate) noexcept : m_blockFrames(std::max(1, sampleRate / 10)) {
+    /*
+     * K 加权由高频搁架和 RLB 高通两级双二阶滤波器组成，系数按 BS.1770 的模拟原型对任意采样率做双线性变换
+     */
+    constexpr double Pi = 3.14159265358979323846;
+    const double rate = std::max(1, sampleRate);
+    {
+        const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+        const double k = std::tan(Pi * f0 / rate);
+        const double vh = std::pow(10.0, gain / 20.0), vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        m_shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+                   2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = std::tan(Pi * f0 / rate);
+        const double a0 = 1.0 + k / q + k * k;
+        m_highPass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+    }
+}
+
+void LoudnessMeter::process(const qint16* interleaved, qint64 frames) noexcept {
+    /*
+     * 两级滤波后累加能量，每满 100 毫秒记录一个子块，400 毫秒的门限块由相邻四个子块组成
+     */
+    constexpr double Scale = 1.0 / 32768.0;
+    for (qint64 i = 0; i < frames; i++) {
+        for (int c = 0; c < 2; c++) {
+            const qint16 sample = interleaved[i * 2 + c];
+            m_peak = std::max(m_peak, std::abs(float(sample)) / 32768.0f);
+            double* s = m_state[c];
+            const double x = sample * Scale;
+            const double y = m_shelf.b0 * x + s[0];
+            s[0] = m_shelf.b1 * x - m_shelf.a1 * y + s[1];
+            s[1] = m_shelf.b2 * x - m_shelf.a2 * y;
+            const double z = m_highPass.b0 * y + s[2];
+            s[2] = m_highPass.b1 * y - m_highPass.a1 * z + s[3];
+            s[3] = m_highPass.b2 * y - m_highPass.a2 * z;
+            m_energy += z * z;
+        }
+        if (++m_blockFill == m_blockFrames) {
+            m_subBlocks.push_back(m_energy / double(m_blockFrames));
+            m_energy = 0.0;
+            m_blockFill = 0;
+        }
+    }
+}
+
+double LoudnessMeter::integratedLoudness() const noexcept {
+    /*
+     * 先用 -70 LUFS 的绝对门限，再用比平均响度低 10 LU 的相对门限，数据不足一个门限块时返回 NaN
+     */
+    const auto loudness = [](double power) { return -0.691 + 10.0 * std::log10(power); };
+    std::vector<double> blocks;
+    for (size_t j = 0; j + 4 <= m_subBlocks.size(); j++) {
+        const double power = (m_subBlocks[j] + m_subBlocks[j + 1] + m_subBlocks[j + 2] + m_subBlocks[j + 3]) / 4.0;
+        if (power > 0.0 && loudness(power) > -70.0) blocks.push_back(power);
+    }
+    if (blocks.empty()) return std::numeric_limits<double>::quiet_NaN();
+    double sum = 0.0;
+    for (const double power : blocks) sum += power;
+    const double threshold = loudness(sum / double(blocks.size())) - 10.0;
+    double gated = 0.0;
+    qint64 count = 0;
+    for (const double power : blocks) {
+        if (loudness(power) <= threshold) continue;
+        gated += power;
+        count++;
+    }
+    return count > 0 ? loudness(gated / double(count)) : std::numeric_limits<double>::quiet_NaN();
+}
+
+double LoudnessMeter::replayGain() const noexcept {
+    return ReferenceLoudness - integratedLoudness();
+}
+
+float LoudnessMeter::peak() const noexcept {
+    return m_peak;
+}
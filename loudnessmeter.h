@@ -0,0 +1,35 @@
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <vector>
+
+#include <QtGlobal>
+
+/*
+ * 按 EBU R128 / ITU-R BS.1770 计算立体声的综合响度（LUFS）和采样峰值，数据可以分多次送入
+ */
+class LoudnessMeter {
+public:
+    static constexpr double ReferenceLoudness = -18.0;  // ReplayGain 2.0 的参考响度
+
+    explicit LoudnessMeter(int sampleRate = 44100) noexcept;
+
+    void process(const qint16* interleaved, qint64 frames) noexcept;
+    double integratedLoudness() const noexcept;
+    double replayGain() const noexcept;
+    float peak() const noexcept;
+
+private:
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    Biquad m_shelf, m_highPass;
+    double m_state[2][4]{};   // 每个声道两级滤波器的状态
+    double m_energy{0.0};     // 当前 100 毫秒子块的能量累加
+    qint64 m_blockFrames, m_blockFill{0};
+    std::vector<double> m_subBlocks;  // 每个 100 毫秒子块的均方值
+    float m_peak{0.0f};
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <iterator>
+
+#include <QStringList>
+
+#include "lyrics.h"
+
+namespace {
+
+bool parseTime(QStringView tag, qint64& milliseconds) noexcept {
+    /*
+     * 解析 mm:ss、mm:ss.xx、mm:ss.xxx 和 mm:ss:xx 形式的时间标签
+     */
+    const qsizetype colon = tag.indexOf(':');
+    if (colon <= 0) return false;
+    bool ok = false;
+    const qint64 minutes = tag.left(colon).toLongLong(&ok);
+    if (!ok || minutes < 0) return false;
+    const QStringView rest = tag.mid(colon + 1);
+    qsizetype separator = rest.indexOf('.');
+    if (separator < 0) separator = rest.indexOf(':');
+    const qint64 seconds = (separator < 0 ? rest : rest.left(separator)).toLongLong(&ok);
+    if (!ok || seconds < 0 || seconds >= 60) return false;
+    qint64 fraction = 0;
+    if (separator >= 0) {
+        const QStringView digits = rest.mid(separator + 1).left(3);
+        fraction = digits.toLongLong(&ok);
+        if (!ok || fraction < 0) return false;
+        for (qsizetype n = digits.size(); n < 3; n++) fraction *= 10;
+    }
+    milliseconds = (minutes * 60 + seconds) * 1000 + fraction;
+    return true;
+}
+
+Lyrics::Line parseWords(QStringView text) noexcept {
+    /*
+     * 拆出增强格式中的 <mm:ss.xx> 逐字标签，返回去掉标签后的文本和每个词的起止
+     */
+    Lyrics::Line line;
+    qsizetype pos = 0;
+    while (pos < text.size()) {
+        const qsizetype open = text.indexOf('<', pos);
+        const qsizetype close = open < 0 ? -1 : text.indexOf('>', open);
+        qint64 time = 0;
+        if (close < 0 || !parseTime(text.mid(open + 1, close - open - 1), time)) {
+            line.text += text.mid(pos, open < 0 ? -1 : open + 1 - pos);
+            if (open < 0) break;
+            pos = open + 1;
+            continue;
+        }
+        line.text += text.mid(pos, open - pos);
+        if (!line.words.empty()) line.words.back().end = int(line.text.size());
+        line.words.push_back({time, int(line.text.size())});
+        pos = close + 1;
+    }
+    if (!line.words.empty()) line.words.back().end = int(line.text.size());
+    return line;
+}
+
+}
+
+Lyrics Lyrics::parse(const QString& source) noexcept {
+    /*
+     * 逐行解析 LRC：一行可以带多个时间标签，[offset:] 对整首歌生效，行内的 <mm:ss.xx> 按增强格式处理。
+     * 没有任何时间标签时按纯文本歌词保存
+     */
+    struct Stamped {
+        qint64 time;
+        Line line;
+    };
+    std::vector<Stamped> stamped;
+    QStringList plain;
+    qint64 offset = 0;
+    for (QStringView row : QStringView(source).split('\n')) {
+        if (row.endsWith('\r')) row.chop(1);
+        std::vector<qint64> times;
+        qsizetype pos = 0;
+        while (pos < row.size() && row[pos] == '[') {
+            const qsizetype close = row.indexOf(']', pos);
+            if (close < 0) break;
+            const QStringView tag = row.mid(pos + 1, close - pos - 1);
+            qint64 time = 0;
+            if (parseTime(tag, time)) times.push_back(time);
+            else if (tag.startsWith(QLatin1String("offset:"), Qt::CaseInsensitive)) offset = tag.mid(7).trimmed().toLongLong();
+            pos = close + 1;
+        }
+        if (times.empty()) {
+            if (pos == 0) plain << row.toString();
+            continue;
+        }
+        const Line line = parseWords(row.mid(pos).trimmed());
+        for (const qint64 time : times) stamped.push_back({time, line});
+    }
+
+    Lyrics lyrics;
+    if (stamped.empty()) {
+        lyrics.m_plain = plain.join('\n').trimmed();
+        return lyrics;
+    }
+    /*
+     * 正的 offset 让歌词提前出现
+     */
+    std::stable_sort(stamped.begin(), stamped.end(), [](const Stamped& a, const Stamped& b) { return a.time < b.time; });
+    lyrics.m_times.reserve(stamped.size());
+    lyrics.m_lines.reserve(stamped.size());
+    for (Stamped& entry : stamped) {
+        lyrics.m_times.push_back(entry.time - offset);
+        for (Word& word : entry.line.words) word.time -= offset;
+        lyrics.m_lines.push_back(std::move(entry.line));
+    }
+    return lyrics;
+}
+
+int Lyrics::lineAt(qint64 position, int hint) const noexcept {
+    /*
+     * 返回 position 时正在唱的行，还没到第一行时返回 -1。
+     * 正常播放时位置只会落在上一次的行或下一行，先检查这两处，快进快退时再二分查找
+     */
+    const int n = int(m_times.size());
+    const auto covers = [this, n, position](int i) {
+        return m_times[i] <= position && (i + 1 == n || position < m_times[i + 1]);
+    };
+    if (hint >= 0 && hint < n) {
+        if (covers(hint)) return hint;
+        if (hint + 1 < n && covers(hint + 1)) return hint + 1;
+    }
+    return int(std::upper_bound(m_times.cbegin(), m_times.cend(), position) - m_times.cbegin()) - 1;
+}
+
+int Lyrics::sungLength(int line, qint64 position) const noexcept {
+    /*
+     * 逐字歌词中当前行已经唱到的字符数；没有逐字时间时整行视为已唱
+     */
+    if (line < 0 || line >= int(m_lines.size())) return 0;
+    const std::vector<Word>& words = m_lines[line].words;
+    if (words.empty()) return int(m_lines[line].text.size());
+    const auto it = std::upper_bound(words.cbegin(), words.cend(), position, [](qint64 p, const Word& w) { return p < w.time; });
+    return it == words.cbegin() ? 0 : std::prev(it)->end;
+}
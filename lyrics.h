@@ -0,0 +1,36 @@
+#ifndef LYRICS_H
+#define LYRICS_H
+
+#include <vector>
+
+#include <QString>
+
+class Lyrics {
+public:
+    struct Word {
+        qint64 time;  // 这个词开始唱的时间
+        int end;      // 唱完这个词后已唱部分在行文本中的长度
+    };
+    struct Line {
+        QString text;
+        std::vector<Word> words;  // 增强格式的逐字时间，普通 LRC 为空
+    };
+
+    static Lyrics parse(const QString& source) noexcept;
+
+    bool isEmpty() const noexcept { return m_lines.empty() && m_plain.isEmpty(); }
+    bool isTimed() const noexcept { return !m_lines.empty(); }
+    int lineCount() const noexcept { return int(m_lines.size()); }
+    const Line& line(int index) const noexcept { return m_lines[index]; }
+    const QString& plainText() const noexcept { return m_plain; }
+
+    int lineAt(qint64 position, int hint = -1) const noexcept;
+    int sungLength(int line, qint64 position) const noexcept;
+
+private:
+    std::vector<qint64> m_times;  // 按时间排序，与 m_lines 一一对应
+    std::vector<Line> m_lines;
+    QString m_plain;
+};
+
+#endif // LYRICS_H
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QUrl>
@@ -11,7 +15,14 @@
 #include <QDebug>
 #include <QDragEnterEvent>
 #include <QMimeData>
-#include <QDirIterator>
+#include <QStatusBar>
+#include <QSettings>
+#include <QActionGroup>
+#include <QInputDialog>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QAbstractTextDocumentLayout>
 
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
@@ -19,16 +30,16 @@
 MainWindow::MainWindow(QWidget* parent) noexcept :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    audio(this),
     player(this),
     playlistModel(this),
+    playlistProxy(this),
+    playQueue(playlistModel, this),
     currentTrackIndex(-1),
     isLyricsView(false),
     muted(false),
     volume_(50),
     viewStack(this),
-    lyricsDisplay(this),
-    shuffleIndex(0)
+    lyricsDisplay(this)
 {
     ui->setupUi(this);
     setCentralWidget(ui->central_widget);
@@ -42,15 +53,27 @@ MainWindow::MainWindow(QWidget* parent) noexcept :
     ui->menubar->setWindowFlag(Qt::NoDropShadowWindowHint);
     ui->menubar->setAttribute(Qt::WA_TranslucentBackground, false);
 
-    player.setAudioOutput(&audio);
-    audio.setVolume(0.5f);
+    player.setVolume(0.5f);
+    history.setDirectory(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+    history.load();
+    for (const PlayHistory::Event& event : history.events()) historyRecorded(event);
+    connect(&history, &PlayHistory::recorded, this, &MainWindow::historyRecorded);
+    gapless = QSettings().value("playback/gapless", true).toBool();
 
     setupPlaylist();
+    setupQueue();
     setupLyricsView();
     setupConnections();
     setupTray();
+    setupStatusBar();
+    setupPlaybackMenu();
+    setupLibraryMenu();
 
     playlistModel.loadPlayList();
+    playlistModel.playMode = PlaylistModel::PlayMode(QSettings().value("playback/mode", int(PlaylistModel::Ordered)).toInt());
+    updatePlayModeButton();
+    ui->action_watch_library->setChecked(playlistModel.isWatching());
+    ui->action_gapless->setChecked(gapless);
     updatePlaybackButtons();
 }
 
@@ -59,9 +82,10 @@ void MainWindow::setupPlaylist() noexcept {
      * 初始化和配置主窗口中的播放列表视图（music_list），包括设置数据模型、选择行为、显示样式、列委托、列宽和拉伸方式等，
      * 使播放列表在界面上以合适的方式展示音乐文件信息，并支持删除操作。
      */
-    ui->music_list->setModel(&playlistModel);
+    playlistProxy.setSourceModel(&playlistModel);
+    ui->music_list->setModel(&playlistProxy);
     ui->music_list->setSelectionBehavior(QAbstractItemView::SelectRows);
-    ui->music_list->setSelectionMode(QAbstractItemView::SingleSelection);
+    ui->music_list->setSelectionMode(QAbstractItemView::ExtendedSelection);
     ui->music_list->setAlternatingRowColors(true);
     ui->music_list->setItemDelegateForColumn(PlaylistModel::Delete, new CenterIconDelegate(ui->music_list));
     auto* header = ui->music_list->horizontalHeader();
@@ -70,12 +94,81 @@ void MainWindow::setupPlaylist() noexcept {
     header->setSectionResizeMode(PlaylistModel::Artist, QHeaderView::Stretch);
     header->setSectionResizeMode(PlaylistModel::Album, QHeaderView::Stretch);
     header->setSectionResizeMode(PlaylistModel::Duration, QHeaderView::Fixed);
+    header->setSectionResizeMode(PlaylistModel::Loudness, QHeaderView::Fixed);
+    header->setSectionResizeMode(PlaylistModel::Bpm, QHeaderView::Fixed);
     header->resizeSection(PlaylistModel::Delete, 30);
     header->resizeSection(PlaylistModel::Title, 4);
     header->resizeSection(PlaylistModel::Artist, 3);
     header->resizeSection(PlaylistModel::Album, 3);
     header->resizeSection(PlaylistModel::Duration, 80);
+    header->resizeSection(PlaylistModel::Loudness, 90);
+    header->resizeSection(PlaylistModel::Bpm, 50);
     header->setStretchLastSection(false);
+    header->setSectionsClickable(true);
+    header->setSortIndicator(-1, Qt::AscendingOrder);
+    header->setSortIndicatorShown(true);
+}
+
+void MainWindow::setupQueue() noexcept {
+    /*
+     * 播放队列放在右侧的停靠窗口中，可以拖动调整顺序，双击立即播放，右键移出队列；
+     * 播放列表的右键菜单把选中的曲目排到下一首、加入队尾或从列表中删除。队列变化后重新确定预读的下一首
+     */
+    queueView.setModel(&playQueue);
+    queueView.setSelectionMode(QAbstractItemView::ExtendedSelection);
+    queueView.setDragDropMode(QAbstractItemView::InternalMove);
+    queueView.setDefaultDropAction(Qt::MoveAction);
+    queueView.setContextMenuPolicy(Qt::CustomContextMenu);
+    queueDock.setObjectName("queue_dock");
+    queueDock.setWidget(&queueView);
+    addDockWidget(Qt::RightDockWidgetArea, &queueDock);
+    queueDock.hide();
+    ui->menu_playback->addAction(queueDock.toggleViewAction());
+
+    connect(&queueView, &QListView::doubleClicked, this, [this](const QModelIndex& index) {
+        playTrack(playlistModel.indexOfId(playQueue.idAt(index.row())));
+    });
+    connect(&queueView, &QWidget::customContextMenuRequested, this, [this](const QPoint& pos) {
+        QMenu menu;
+        QAction* removeAction = menu.addAction("移出队列");
+        QAction* clearAction = menu.addAction("清空队列");
+        removeAction->setEnabled(queueView.selectionModel()->hasSelection());
+        clearAction->setEnabled(!playQueue.isEmpty());
+        QAction* chosen = menu.exec(queueView.viewport()->mapToGlobal(pos));
+        if (chosen == removeAction) {
+            std::vector<quint32> ids;
+            for (const QModelIndex& index : queueView.selectionModel()->selectedRows()) ids.push_back(playQueue.idAt(index.row()));
+            for (const quint32 id : ids) playQueue.remove(id);
+        } else if (chosen == clearAction) playQueue.clear();
+    });
+
+    actRemove.setShortcut(QKeySequence::Delete);
+    actRemove.setShortcutContext(Qt::WidgetWithChildrenShortcut);
+    ui->music_list->addAction(&actRemove);
+    connect(&actRemove, &QAction::triggered, this, &MainWindow::removeSelectedTracks);
+    ui->music_list->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->music_list, &QWidget::customContextMenuRequested, this, [this](const QPoint& pos) {
+        QModelIndexList rows = ui->music_list->selectionModel()->selectedRows();
+        if (rows.isEmpty()) return;
+        QMenu menu;
+        QAction* nextAction = menu.addAction("下一首播放");
+        QAction* queueAction = menu.addAction("加入播放队列");
+        menu.addSeparator();
+        menu.addAction(&actRemove);
+        QAction* chosen = menu.exec(ui->music_list->viewport()->mapToGlobal(pos));
+        if (chosen != nextAction && chosen != queueAction) return;
+        std::sort(rows.begin(), rows.end());
+        std::vector<quint32> ids;
+        for (const QModelIndex& index : rows) ids.push_back(playlistModel.trackId(playlistProxy.mapToSource(index).row()));
+        if (chosen == nextAction) for (auto it = ids.rbegin(); it != ids.rend(); ++it) playQueue.playNext(*it);
+        else for (const quint32 id : ids) playQueue.enqueue(id);
+        queueDock.show();
+    });
+
+    connect(&playQueue, &QAbstractItemModel::rowsInserted, this, &MainWindow::refreshNextTrack);
+    connect(&playQueue, &QAbstractItemModel::rowsRemoved, this, &MainWindow::refreshNextTrack);
+    connect(&playQueue, &QAbstractItemModel::rowsMoved, this, &MainWindow::refreshNextTrack);
+    connect(&playQueue, &QAbstractItemModel::modelReset, this, &MainWindow::refreshNextTrack);
 }
 
 void MainWindow::setupLyricsView() noexcept {
@@ -103,6 +196,8 @@ void MainWindow::setupConnections() noexcept {
      */
     connect(ui->action_add_file, &QAction::triggered, this, &MainWindow::openFile);
     connect(ui->action_add_folder, &QAction::triggered, this, &MainWindow::openFolder);
+    connect(ui->action_watch_library, &QAction::toggled, &playlistModel, &PlaylistModel::setWatching);
+    connect(ui->action_gapless, &QAction::toggled, this, &MainWindow::setGapless);
     connect(ui->action_about, &QAction::triggered, this, &MainWindow::showAbout);
     connect(ui->action_exit, &QAction::triggered, this, &QApplication::quit);
 
@@ -112,15 +207,22 @@ void MainWindow::setupConnections() noexcept {
     connect(ui->view_toggle, &QPushButton::clicked, this, &MainWindow::toggleView);
 
     connect(ui->music_list, &QTableView::clicked, this, &MainWindow::onPlaylistClicked);
+    connect(ui->music_list->horizontalHeader(), &QHeaderView::sortIndicatorChanged, this, &MainWindow::sortPlaylist);
+    connect(ui->search_box, &QLineEdit::textChanged, this, &MainWindow::searchChanged);
 
     connect(ui->play_mode, &QPushButton::clicked, this, &MainWindow::playModeClicked);
 
-    connect(&player, &QMediaPlayer::durationChanged, this, &MainWindow::playerDurationChanged);
-    connect(&player, &QMediaPlayer::positionChanged, this, &MainWindow::playerPositionChanged);
-    connect(&player, &QMediaPlayer::mediaStatusChanged, this, &MainWindow::playerMediaStatusChanged);
-    connect(&player, &QMediaPlayer::playbackStateChanged, this, &MainWindow::updatePlaybackButtons);
+    connect(&player, &AudioEngine::durationChanged, this, &MainWindow::playerDurationChanged);
+    connect(&player, &AudioEngine::positionChanged, this, &MainWindow::playerPositionChanged);
+    connect(&player, &AudioEngine::mediaStatusChanged, this, &MainWindow::playerMediaStatusChanged);
+    connect(&player, &AudioEngine::playbackStateChanged, this, &MainWindow::updatePlaybackButtons);
+    connect(&player, &AudioEngine::playbackStateChanged, this, [this](QMediaPlayer::PlaybackState state) {
+        playlistModel.setPlaybackActive(state == QMediaPlayer::PlayingState);
+    });
+    connect(&player, &AudioEngine::aboutToFinish, this, &MainWindow::prepareNextTrack);
+    connect(&player, &AudioEngine::sourceChanged, this, &MainWindow::playerSourceChanged);
 
-    connect(ui->music_progress, &QSlider::sliderMoved, &player, &QMediaPlayer::setPosition);
+    connect(ui->music_progress, &QSlider::sliderMoved, &player, &AudioEngine::setPosition);
     connect(ui->music_progress, &QSlider::sliderPressed, this, &MainWindow::musicProgressPressed);
     connect(ui->music_progress, &QSlider::sliderReleased, this, &MainWindow::musicProgressReleased);
     connect(ui->music_progress, &QSlider::valueChanged, this, &MainWindow::musicProgressValueChanged);
@@ -131,6 +233,220 @@ void MainWindow::setupConnections() noexcept {
 
     connect(&playlistModel, &QAbstractItemModel::rowsInserted, this, &MainWindow::updatePlaybackButtons);
     connect(&playlistModel, &QAbstractItemModel::rowsRemoved, this, &MainWindow::updatePlaybackButtons);
+    connect(&playlistModel, &QAbstractItemModel::dataChanged, this, &MainWindow::playlistDataChanged);
+    connect(&playlistModel, &PlaylistModel::probeProgress, this, &MainWindow::probeProgress);
+    connect(&playlistModel, &PlaylistModel::scanProgress, this, &MainWindow::scanProgress);
+    connect(&playlistModel, &PlaylistModel::scanFinished, this, &MainWindow::scanFinished);
+    connect(&playlistModel, &PlaylistModel::rowsRemapped, this, &MainWindow::playlistRowsRemapped);
+    connect(&playlistModel, &PlaylistModel::trackRemoved, this, &MainWindow::playlistTrackRemoved);
+    connect(&playlistModel, &QAbstractItemModel::modelReset, this, &MainWindow::playlistReset);
+    connect(&playlistModel, &PlaylistModel::playlistChanged, this, &MainWindow::refreshNextTrack);
+    connect(&coverResolver, &CoverResolver::resolved, this, &MainWindow::coverResolved);
+}
+
+void MainWindow::setupStatusBar() noexcept {
+    /*
+     * 在状态栏中放置元数据读取进度条和取消按钮，空闲时隐藏
+     */
+    probeBar.setMaximumWidth(200);
+    probeBar.setTextVisible(true);
+    probeBar.setFormat("读取元数据 %v/%m");
+    probeCancel.setText("取消");
+    probeCancel.setToolTip("停止导入");
+    statusBar()->addPermanentWidget(&probeBar);
+    statusBar()->addPermanentWidget(&probeCancel);
+    probeBar.hide();
+    probeCancel.hide();
+    connect(&probeCancel, &QToolButton::clicked, &playlistModel, &PlaylistModel::cancelImport);
+}
+
+void MainWindow::setupPlaybackMenu() noexcept {
+    /*
+     * 在播放菜单中加入交叉淡化、音量均衡、续播推荐、最近播放和随机方式的选项，选择会被保存
+     */
+    QSettings settings;
+    const bool normalize = settings.value("playback/replayGain", true).toBool();
+    const int preamp = settings.value("playback/preampDb", 0).toInt();
+    player.setNormalization(normalize, float(preamp));
+    const qint64 fade = settings.value("playback/crossfadeMs", 0).toLongLong();
+    const auto curve = AudioEngine::FadeCurve(settings.value("playback/crossfadeCurve", int(AudioEngine::EqualPower)).toInt());
+    player.setCrossfade(fade, curve);
+
+    QMenu* menu = ui->menu_playback->addMenu("交叉淡化");
+    auto* durations = new QActionGroup(menu);
+    for (const qint64 ms : {0, 2000, 5000, 10000}) {
+        QAction* action = menu->addAction(ms == 0 ? QString("关闭") : QString("%1 秒").arg(ms / 1000));
+        action->setCheckable(true);
+        action->setChecked(ms == fade);
+        durations->addAction(action);
+        connect(action, &QAction::triggered, this, [this, ms] {
+            QSettings().setValue("playback/crossfadeMs", ms);
+            player.setCrossfade(ms, player.crossfadeCurve());
+            refreshNextTrack();
+        });
+    }
+    menu->addSeparator();
+    auto* curves = new QActionGroup(menu);
+    const std::pair<AudioEngine::FadeCurve, QString> options[] = {
+        {AudioEngine::Linear, "线性"}, {AudioEngine::EqualPower, "等功率"}, {AudioEngine::SCurve, "S 曲线"}
+    };
+    for (const auto& option : options) {
+        const AudioEngine::FadeCurve value = option.first;
+        QAction* action = menu->addAction(option.second);
+        action->setCheckable(true);
+        action->setChecked(value == curve);
+        curves->addAction(action);
+        connect(action, &QAction::triggered, this, [this, value] {
+            QSettings().setValue("playback/crossfadeCurve", int(value));
+            player.setCrossfade(player.crossfadeDuration(), value);
+        });
+    }
+
+    QMenu* gainMenu = ui->menu_playback->addMenu("音量均衡");
+    QAction* enable = gainMenu->addAction("按曲目增益调整响度");
+    enable->setCheckable(true);
+    enable->setChecked(normalize);
+    connect(enable, &QAction::toggled, this, [this](bool enabled) {
+        QSettings().setValue("playback/replayGain", enabled);
+        player.setNormalization(enabled, player.preamp());
+    });
+    gainMenu->addSeparator();
+    auto* preamps = new QActionGroup(gainMenu);
+    for (const int db : {-6, -3, 0, 3, 6}) {
+        QAction* action = gainMenu->addAction(QString("前置增益 %1%2 dB").arg(db > 0 ? "+" : "").arg(db));
+        action->setCheckable(true);
+        action->setChecked(db == preamp);
+        preamps->addAction(action);
+        connect(action, &QAction::triggered, this, [this, db] {
+            QSettings().setValue("playback/preampDb", db);
+            player.setNormalization(player.normalization(), float(db));
+        });
+    }
+
+    recommend = settings.value("playback/recommend", false).toBool();
+    QAction* recommendAction = ui->menu_playback->addAction("按收听习惯续播");
+    recommendAction->setCheckable(true);
+    recommendAction->setChecked(recommend);
+    connect(recommendAction, &QAction::toggled, this, [this](bool enabled) {
+        QSettings().setValue("playback/recommend", enabled);
+        recommend = enabled;
+        refreshNextTrack();
+    });
+
+    QMenu* recentMenu = ui->menu_playback->addMenu("最近播放");
+    connect(recentMenu, &QMenu::aboutToShow, this, [this, recentMenu] {
+        recentMenu->clear();
+        for (const QString& path : history.recent(20)) {
+            const int index = playlistModel.indexOf(path);
+            const auto track = playlistModel.getTrack(index);
+            QAction* action = recentMenu->addAction(track ? track->artist + " - " + track->title : QFileInfo(path).baseName());
+            action->setEnabled(track.has_value());
+            if (!track) continue;
+            const quint32 id = track->id;
+            connect(action, &QAction::triggered, this, [this, id] { playTrack(playlistModel.indexOfId(id)); });
+        }
+        if (recentMenu->isEmpty()) recentMenu->addAction("暂无记录")->setEnabled(false);
+    });
+
+    QMenu* shuffleMenu = ui->menu_playback->addMenu("随机方式");
+    auto* shuffleModes = new QActionGroup(shuffleMenu);
+    const std::pair<ShuffleQueue::Mode, QString> modes[] = {
+        {ShuffleQueue::Uniform, "完全随机"}, {ShuffleQueue::Weighted, "新加入的曲目优先"}, {ShuffleQueue::ArtistSpread, "分散同一艺术家"}
+    };
+    for (const auto& mode : modes) {
+        const ShuffleQueue::Mode value = mode.first;
+        QAction* action = shuffleMenu->addAction(mode.second);
+        action->setCheckable(true);
+        action->setChecked(value == playlistModel.shuffleMode());
+        shuffleModes->addAction(action);
+        connect(action, &QAction::triggered, this, [this, value] {
+            playlistModel.setShuffleMode(value);
+            if (playlistModel.playMode != PlaylistModel::Shuffled) return;
+            restartShuffle();
+            refreshNextTrack();
+        });
+    }
+}
+
+void MainWindow::setupLibraryMenu() noexcept {
+    /*
+     * 菜单栏中的列表菜单：列出所有播放列表，点击切换；可以新建、重命名和删除当前列表，至少保留一个
+     */
+    QMenu* menu = new QMenu("列表", ui->menubar);
+    menu->setFont(ui->menu_file->font());
+    ui->menubar->insertMenu(ui->menu_playback->menuAction(), menu);
+    connect(menu, &QMenu::aboutToShow, this, [this, menu] {
+        menu->clear();
+        auto* playlists = new QActionGroup(menu);
+        for (int index = 0; index < playlistModel.playlistCount(); index++) {
+            QAction* action = menu->addAction(playlistModel.playlistName(index));
+            action->setCheckable(true);
+            action->setChecked(index == playlistModel.currentPlaylist());
+            playlists->addAction(action);
+            connect(action, &QAction::triggered, this, [this, index] { playlistModel.openPlaylist(index); });
+        }
+        menu->addSeparator();
+        connect(menu->addAction("新建播放列表..."), &QAction::triggered, this, [this] {
+            bool ok = false;
+            const QString name = QInputDialog::getText(this, "新建播放列表", "列表名称：", QLineEdit::Normal, QString("列表 %1").arg(playlistModel.playlistCount() + 1), &ok).trimmed();
+            if (ok && !name.isEmpty()) playlistModel.createPlaylist(name);
+        });
+        connect(menu->addAction("重命名当前列表..."), &QAction::triggered, this, [this] {
+            const int index = playlistModel.currentPlaylist();
+            bool ok = false;
+            const QString name = QInputDialog::getText(this, "重命名播放列表", "列表名称：", QLineEdit::Normal, playlistModel.playlistName(index), &ok).trimmed();
+            if (ok && !name.isEmpty()) playlistModel.renamePlaylist(index, name);
+        });
+        QAction* removeAction = menu->addAction("删除当前列表");
+        removeAction->setEnabled(playlistModel.playlistCount() > 1);
+        connect(removeAction, &QAction::triggered, this, [this] {
+            const int index = playlistModel.currentPlaylist();
+            if (QMessageBox::question(this, "删除播放列表", QString("确定删除播放列表“%1”吗？").arg(playlistModel.playlistName(index))) == QMessageBox::Yes)
+                playlistModel.removePlaylist(index);
+        });
+    });
+}
+
+void MainWindow::probeProgress(int done, int total) noexcept {
+    /*
+     * 更新状态栏中的元数据读取进度，全部完成或被取消后隐藏进度条
+     */
+    const bool busy = total > 0 && done < total;
+    probeBar.setVisible(busy);
+    probeCancel.setVisible(busy || playlistModel.isScanning());
+    if (busy) {
+        probeBar.setRange(0, total);
+        probeBar.setValue(done);
+    }
+}
+
+void MainWindow::scanProgress(int directories, int files) noexcept {
+    /*
+     * 在状态栏显示文件夹扫描进度
+     */
+    statusBar()->showMessage(QString("正在扫描：%1 个文件夹，%2 首音乐").arg(directories).arg(files));
+    probeCancel.show();
+}
+
+void MainWindow::scanFinished() noexcept {
+    statusBar()->clearMessage();
+    probeCancel.setVisible(probeBar.isVisible());
+}
+
+void MainWindow::playlistDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) noexcept {
+    /*
+     * 当前播放曲目的元数据在后台读取完成后，刷新界面上的播放信息
+     */
+    if (currentTrackIndex >= topLeft.row() && currentTrackIndex <= bottomRight.row()) updatePlayingInfo();
+}
+
+void MainWindow::searchChanged(const QString& text) noexcept {
+    /*
+     * 每次输入都重新过滤播放列表，过滤后仍可见的当前曲目保持选中
+     */
+    playlistProxy.setFilter(&playlistModel, text);
+    const QModelIndex visible = playlistProxy.mapFromSource(playlistModel.index(currentTrackIndex, 0));
+    if (visible.isValid()) ui->music_list->selectRow(visible.row());
 }
 
 void MainWindow::openFile() noexcept {
@@ -138,7 +454,8 @@ void MainWindow::openFile() noexcept {
      * 弹出文件选择对话框，让用户选择一个或多个音乐文件（如 mp3、flac 等），然后将选中的文件添加到播放列表模型 playlistModel 中，实现音乐文件的导入功能。
      */
     const QStringList files = QFileDialog::getOpenFileNames(this, "选择音乐文件", QDir::homePath(), "音乐文件 (*.mp3 *.flac *.aac *.wav *.m4a *.ogg *.wma *.mgg)");
-    if (!files.isEmpty()) for(int i = 0; i < files.size(); i++) playlistModel.addMusicFile(files[i]);
+    if (files.size() == 1) playlistModel.addMusicFile(files[0]);
+    else if (!files.isEmpty()) playlistModel.addMusicFiles(files);
 }
 
 void MainWindow::openFolder() noexcept {
@@ -167,23 +484,28 @@ void MainWindow::togglePlayback() noexcept {
 void MainWindow::previousTrack() noexcept {
     /*
      * 切换到上一首音乐。它根据当前播放模式（顺序、随机、单曲循环）决定上一首曲目的索引，并调用 playTrack() 播放上一首。
-     * 如果播放列表为空则直接返回。顺序模式下，回到上一首或列表末尾；随机模式下，按乱序列表回退；循环模式下，重复当前曲目。
+     * 如果播放列表为空则直接返回。顺序模式下，回到上一首或列表末尾；随机模式下，沿播放历史回到更早播放的曲目，
+     * 跳过已不在列表中的，历史走完后退回本轮随机队列中的上一首；循环模式下，重复当前曲目。
      */
-    if (playlistModel.getTrackCount() == 0) return;
+    const int count = playlistModel.getTrackCount();
+    if (count == 0) return;
     switch(playlistModel.playMode) {
     case PlaylistModel::Ordered:
-        if (currentTrackIndex > 0) playTrack(currentTrackIndex - 1);
-        else playTrack(playlistModel.getTrackCount() - 1);
+        playTrack(currentTrackIndex > 0 ? currentTrackIndex - 1 : count - 1);
         break;
-    case PlaylistModel::Shuffled:
-        int previous;
-        do {
-            if(shuffleIndex == 0) shuffleIndex = playlistModel.order.size() - 1;
-            else shuffleIndex--;
-            previous = playlistModel.order[shuffleIndex];
-        } while(previous > playlistModel.getTrackCount() - 1);
-        playTrack(previous);
+    case PlaylistModel::Shuffled: {
+        for (QString path = history.back(); !path.isEmpty(); path = history.back()) {
+            const int index = playlistModel.indexOf(path);
+            if (index < 0 || index == currentTrackIndex) continue;
+            revisiting = true;
+            playTrack(index);
+            revisiting = false;
+            return;
+        }
+        const int previous = playlistModel.shufflePrevious();
+        if (previous >= 0) playTrack(previous);
         break;
+    }
     case PlaylistModel::Looped:
         playTrack(currentTrackIndex);
         break;
@@ -193,27 +515,34 @@ void MainWindow::previousTrack() noexcept {
 void MainWindow::nextTrack() noexcept {
     /*
      * 意图是切换到下一首音乐。它根据当前播放模式（顺序、随机、单曲循环）决定下一首曲目的索引，并调用 playTrack() 播放下一首。
-     * 如果播放列表为空则直接返回。顺序模式下，进入下一首或回到列表开头；随机模式下，按乱序列表前进；循环模式下，重复当前曲目。
      */
-    if (playlistModel.getTrackCount() == 0) return;
+    const int next = followingTrack();
+    if (next >= 0) playTrack(next);
+}
+
+int MainWindow::followingTrack() noexcept {
+    /*
+     * 按播放模式算出下一首的索引，不前进播放位置，供切歌和无缝播放的预读共用。
+     * 顺序模式下进入下一首或回到列表开头；随机模式下取随机队列中的下一首，本轮播完时重新洗牌；循环模式下重复当前曲目。
+     * 播放队列不为空时总是先播放队首；开启按收听习惯续播时，顺序和随机模式优先选择以往在当前曲目之后常被听完的曲目。
+     */
+    const int count = playlistModel.getTrackCount();
+    if (count == 0) return -1;
+    if (!playQueue.isEmpty()) return playlistModel.indexOfId(playQueue.front());
+    if (recommend && playlistModel.playMode != PlaylistModel::Looped) {
+        const quint32 id = transitions.next([this](quint32 id) { return playlistModel.contains(history.path(id)); });
+        const int index = id != TransitionGraph::None ? playlistModel.indexOf(history.path(id)) : -1;
+        if (index >= 0) return index;
+    }
     switch(playlistModel.playMode) {
     case PlaylistModel::Ordered:
-        if (currentTrackIndex < playlistModel.getTrackCount() - 1) playTrack(currentTrackIndex + 1);
-        else playTrack(0);
-        break;
+        return currentTrackIndex < count - 1 ? currentTrackIndex + 1 : 0;
     case PlaylistModel::Shuffled:
-        int next;
-        do {
-            if(shuffleIndex == playlistModel.order.size() - 1) shuffleIndex = 0;
-            else shuffleIndex++;
-            next = playlistModel.order[shuffleIndex];
-        } while(next > playlistModel.getTrackCount() - 1);
-        playTrack(next);
-        break;
+        return playlistModel.shuffleNext();
     case PlaylistModel::Looped:
-        playTrack(currentTrackIndex);
-        break;
+        return currentTrackIndex;
     }
+    return -1;
 }
 
 void MainWindow::playTrack(int index) noexcept {
@@ -230,62 +559,185 @@ void MainWindow::playTrack(int index) noexcept {
     总之，实现了“播放指定索引的音乐并同步界面显示”的功能。
      */
     if (index < 0 || index >= playlistModel.getTrackCount()) return;
-    const auto* file = playlistModel.getTrack(index);
-    if (file != nullptr) {
+    const auto file = playlistModel.getTrack(index);
+    if (file) {
+        closeHistory(false);
+        if (revisiting) history.revisited(file->filePath);
+        else history.played(file->filePath);
+        historyPath = file->filePath;
         currentTrackIndex = index;
-        player.setSource(QUrl::fromLocalFile(file->filePath));
+        nextIndex = -1;
+        if (playlistModel.playMode == PlaylistModel::Shuffled) playlistModel.shufflePlayed(index);
+        player.setSource(QUrl::fromLocalFile(file->filePath), trackGain(index));
         player.play();
+        playQueue.remove(file->id);
+        showTrack(index);
+    }
+}
+
+void MainWindow::showTrack(int index) noexcept {
+    /*
+     * 开始播放一首曲目后同步窗口标题、托盘通知、列表选中行和播放信息
+     */
+    const auto file = playlistModel.getTrack(index);
+    if (file) {
         QFileInfo fileInfo(file->filePath);
         setWindowTitle(fileInfo.baseName() + " - Whatever");
         if (QSystemTrayIcon::supportsMessages()) {
             QIcon smallArt;
-            if(!file->cover.isNull()) {
-                QPixmap temp(QPixmap::fromImage(file->cover));
+            const QImage cover = playlistModel.thumbnail(index);
+            if(!cover.isNull()) {
+                QPixmap temp(QPixmap::fromImage(cover));
                 smallArt.addPixmap(temp);
             }
             if(smallArt.isNull()) trayIcon.showMessage("正在播放", file->artist + " - " + file->title, QSystemTrayIcon::Information, 1000);
             else trayIcon.showMessage("正在播放", file->artist + " - " + file->title, smallArt, 1000);
         }
-        ui->music_list->selectRow(index);
+        playlistModel.fetchUpTo(index);
+        const QModelIndex visible = playlistProxy.mapFromSource(playlistModel.index(index, 0));
+        if (visible.isValid()) ui->music_list->selectRow(visible.row());
+        else ui->music_list->clearSelection();
         updatePlayingInfo();
     }
 }
 
+void MainWindow::prepareNextTrack() noexcept {
+    /*
+     * 当前曲目快结束时按播放模式确定下一首，交给播放器提前解码，播完后无缝接上或交叉淡化
+     */
+    if (!gapless && player.crossfadeDuration() == 0) return;
+    const int next = followingTrack();
+    const auto file = playlistModel.getTrack(next);
+    if (!file) return;
+    nextIndex = next;
+    player.setNextSource(QUrl::fromLocalFile(file->filePath), trackGain(next));
+}
+
+float MainWindow::trackGain(int index) const noexcept {
+    /*
+     * 标签中没有 ReplayGain 时使用后台分析测得的响度，都没有时返回 NaN，由播放器在解码后自行测量
+     */
+    const auto file = playlistModel.getTrack(index);
+    if (!file) return std::numeric_limits<float>::quiet_NaN();
+    if (!std::isnan(file->replayGain)) return file->replayGain;
+    const TrackAnalysis* analysis = playlistModel.analysis(index);
+    return analysis != nullptr ? analysis->replayGain() : std::numeric_limits<float>::quiet_NaN();
+}
+
+void MainWindow::refreshNextTrack() noexcept {
+    /*
+     * 播放列表、播放模式或无缝设置变化后，重新确定已经预读的下一首
+     */
+    if (player.nextSource().isEmpty()) return;
+    nextIndex = -1;
+    player.setNextSource(QUrl());
+    prepareNextTrack();
+}
+
+void MainWindow::playerSourceChanged(const QUrl& source) noexcept {
+    /*
+     * 播放器无缝切换到预读的曲目后同步界面。预读之后列表有变动时按路径重新找到这一首
+     */
+    if (nextIndex < 0 || source.isEmpty()) return;
+    int index = nextIndex;
+    const auto file = playlistModel.getTrack(index);
+    if (!file || QUrl::fromLocalFile(file->filePath) != source) index = playlistModel.indexOf(source.toLocalFile());
+    closeHistory(true);
+    history.played(source.toLocalFile());
+    historyPath = source.toLocalFile();
+    nextIndex = -1;
+    currentTrackIndex = index;
+    if (index >= 0 && playlistModel.playMode == PlaylistModel::Shuffled) playlistModel.shufflePlayed(index);
+    if (index >= 0) playQueue.remove(playlistModel.trackId(index));
+    if (index >= 0) showTrack(index);
+    else updatePlayingInfo();
+}
+
+void MainWindow::sortPlaylist(int column, Qt::SortOrder order) noexcept {
+    /*
+     * 点击表头按该列重排播放列表；删除、响度和 BPM 列不参与排序，点击时清除排序标记
+     */
+    if (column != PlaylistModel::Title && column != PlaylistModel::Artist && column != PlaylistModel::Album && column != PlaylistModel::Duration) {
+        const QSignalBlocker blocker(ui->music_list->horizontalHeader());
+        ui->music_list->horizontalHeader()->setSortIndicator(-1, order);
+        return;
+    }
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    playlistModel.sort(column, order);
+    QApplication::restoreOverrideCursor();
+}
+
+void MainWindow::playlistRowsRemapped(const std::vector<int>& rows) noexcept {
+    /*
+     * 列表重排后把正在播放和已预读的曲目换成新行号，随机播放队列按曲目编号记录，不受影响
+     */
+    const auto remap = [&rows](int row) { return row >= 0 && row < int(rows.size()) ? rows[row] : -1; };
+    currentTrackIndex = remap(currentTrackIndex);
+    nextIndex = remap(nextIndex);
+}
+
+void MainWindow::playlistReset() noexcept {
+    /*
+     * 列表被清空、重新加载或切换后原来的行号全部作废：正在播放的曲目按路径在新列表中重新找，找不到时继续播放但不对应任何行
+     */
+    const QUrl source = player.source();
+    currentTrackIndex = source.isEmpty() ? -1 : playlistModel.indexOf(source.toLocalFile());
+    nextIndex = -1;
+    refreshNextTrack();
+    updatePlaybackButtons();
+}
+
+void MainWindow::playlistTrackRemoved(int row, quint32 id) noexcept {
+    /*
+     * 删除一行后，它之后的行号都减一；删除的正是当前曲目时继续播放，但不再对应列表中的行
+     */
+    Q_UNUSED(id)
+    const auto shift = [row](int index) { return index == row ? -1 : index > row ? index - 1 : index; };
+    currentTrackIndex = shift(currentTrackIndex);
+    nextIndex = shift(nextIndex);
+}
+
+void MainWindow::setGapless(bool enabled) noexcept {
+    /*
+     * 开关无缝播放，设置会被保存
+     */
+    gapless = enabled;
+    QSettings().setValue("playback/gapless", enabled);
+    if (enabled) prepareNextTrack();
+    else refreshNextTrack();
+}
+
 void MainWindow::updatePlayingInfo() noexcept {
     /*
      * 根据当前播放的曲目索引，更新主界面上的播放信息，包括显示当前歌曲的元数据（如歌手和标题）、专辑封面、歌词视图内容等。
      * 如果没有正在播放的曲目，则显示默认提示和默认封面。这样可以保证界面信息与实际播放状态同步。
      */
     if (currentTrackIndex >= 0 && currentTrackIndex < playlistModel.getTrackCount()) {
-        const auto* file = playlistModel.getTrack(currentTrackIndex);
+        const auto file = playlistModel.getTrack(currentTrackIndex);
         ui->metadata->setText(file->artist + " - " + file->title);
+        const TrackAnalysis* analysis = playlistModel.analysis(currentTrackIndex);
+        ui->music_progress->setWaveform(analysis != nullptr ? analysis->waveform : QByteArray());
         if (isLyricsView) updateLyricsDisplay();
-        if (!file->cover.isNull()) ui->album_cover->setPixmap(QPixmap::fromImage(file->cover));
-        else {
-            bool found = false;
-            const QDir dir{QFileInfo(file->filePath).absolutePath()};
-            static const QStringList names = { "cover.jpg", "Cover.jpg", "folder.jpg", "Folder.jpg" };
-            for (const QString& n : names) {
-                const QString file_ = dir.filePath(n);
-                if (QFile::exists(file_)) {
-                    QImage img(file_);
-                    if (!img.isNull()) {
-                        ui->album_cover->setPixmap(QPixmap::fromImage(img));
-                        found = true;
-                        break;
-                    }
-                }
-            }
-            if(!found) ui->album_cover->setPixmap(QPixmap(":/assets/material-symbols-music-cast-rounded.png"));
-        }
+        coverRequest = coverResolver.resolve(playlistModel.coverPath(currentTrackIndex), file->filePath, file->album, ui->album_cover->size() * devicePixelRatio());
     }
     else {
+        coverRequest = 0;
         ui->metadata->setText("未在播放");
+        ui->music_progress->setWaveform(QByteArray());
         ui->album_cover->setPixmap(QPixmap(":/assets/material-symbols-music-cast-rounded.png"));
-        if (isLyricsView) lyricsDisplay.setPlainText("暂无歌词");
+        if (isLyricsView) updateLyricsDisplay();
     }
 }
 
+void MainWindow::coverResolved(quint64 request, const QImage& image) noexcept {
+    /*
+     * 后台查找到封面后显示在界面上，找不到时显示默认图标。过期请求的结果直接忽略
+     */
+    if (request != coverRequest) return;
+    if (image.isNull()) ui->album_cover->setPixmap(QPixmap(":/assets/material-symbols-music-cast-rounded.png"));
+    else ui->album_cover->setPixmap(QPixmap::fromImage(image));
+}
+
 void MainWindow::toggleView() noexcept {
     /*
      * 用于在主窗口中切换“播放列表视图”和“歌词视图”。
@@ -307,20 +759,70 @@ void MainWindow::toggleView() noexcept {
 void MainWindow::updateLyricsDisplay() noexcept {
     /*
      * 用于根据当前播放的曲目，更新歌词显示区域的内容。如果有正在播放的曲目且能成功加载歌词文件，则显示歌词；否则显示“暂无歌词”。这样可以保证歌词视图与当前播放状态同步。
+     * 解析结果按曲目缓存，来回切换视图不会重新读盘；带时间的歌词随后按播放位置高亮当前行。
      */
+    lyrics = Lyrics();
     if (currentTrackIndex >= 0 && currentTrackIndex < playlistModel.getTrackCount()) {
-        const auto* file = playlistModel.getTrack(currentTrackIndex);
-        if(file == nullptr) return;
-        QString lyrics = loadLyrics(file->filePath);
-        if (lyrics.isEmpty()) lyricsDisplay.setPlainText("暂无歌词");
-        else lyricsDisplay.setPlainText(lyrics);
+        const auto file = playlistModel.getTrack(currentTrackIndex);
+        if(!file) return;
+        if (const Lyrics* cached = lyricsCache.object(file->filePath)) lyrics = *cached;
+        else {
+            lyrics = loadLyrics(file->filePath);
+            lyricsCache.insert(file->filePath, new Lyrics(lyrics));
+        }
+    }
+    lyricsLine = lyricsSung = -1;
+    if (lyrics.isEmpty()) lyricsDisplay.setPlainText("暂无歌词");
+    else if (!lyrics.isTimed()) lyricsDisplay.setPlainText(lyrics.plainText());
+    else {
+        QStringList rows;
+        for (int i = 0; i < lyrics.lineCount(); i++) rows << lyrics.line(i).text;
+        lyricsDisplay.setPlainText(rows.join('\n'));
+        highlightLyrics(player.position());
     }
-    else lyricsDisplay.setPlainText("暂无歌词");
 }
 
-QString MainWindow::loadLyrics(const QString &filePath) const noexcept {
+void MainWindow::highlightLyrics(qint64 position) noexcept {
     /*
-     * 根据传入的音乐文件路径，尝试在同目录下加载对应的歌词文件（优先.lrc，其次.txt），并返回歌词内容字符串。如果没有找到歌词文件，则返回空字符串。这样可以实现自动匹配和显示当前播放音乐的歌词。
+     * 从上一次的行开始查找当前行，只有当前行或逐字进度变化时才改格式，换行时才滚动
+     */
+    if (!isLyricsView || !lyrics.isTimed()) return;
+    const int line = lyrics.lineAt(position, lyricsLine);
+    const int sung = lyrics.sungLength(line, position);
+    if (line == lyricsLine && sung == lyricsSung) return;
+    if (line != lyricsLine && lyricsLine >= 0) formatLyricsLine(lyricsLine, 0, false);
+    if (line >= 0) formatLyricsLine(line, sung, true);
+    if (line != lyricsLine && line >= 0) {
+        const QTextBlock block = lyricsDisplay.document()->findBlockByNumber(line);
+        const QRectF rect = lyricsDisplay.document()->documentLayout()->blockBoundingRect(block);
+        lyricsDisplay.verticalScrollBar()->setValue(int(rect.center().y()) - lyricsDisplay.viewport()->height() / 2);
+    }
+    lyricsLine = line;
+    lyricsSung = sung;
+}
+
+void MainWindow::formatLyricsLine(int line, int sung, bool active) noexcept {
+    /*
+     * 当前行加粗，已唱部分用高亮色；离开的行恢复普通格式
+     */
+    const QTextBlock block = lyricsDisplay.document()->findBlockByNumber(line);
+    if (!block.isValid()) return;
+    QTextCursor cursor(block);
+    cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+    QTextCharFormat format;
+    format.setFontWeight(active ? QFont::Bold : QFont::Normal);
+    format.setForeground(palette().text());
+    cursor.setCharFormat(format);
+    if (!active || sung <= 0) return;
+    cursor.setPosition(block.position());
+    cursor.setPosition(block.position() + qMin(sung, block.length() - 1), QTextCursor::KeepAnchor);
+    format.setForeground(palette().highlight());
+    cursor.setCharFormat(format);
+}
+
+Lyrics MainWindow::loadLyrics(const QString &filePath) const noexcept {
+    /*
+     * 根据传入的音乐文件路径，尝试在同目录下加载对应的歌词文件（优先.lrc，其次.txt），并返回解析后的歌词。如果没有找到歌词文件，则返回空歌词。这样可以实现自动匹配和显示当前播放音乐的歌词。
      */
     QFileInfo fileInfo(filePath);
     QString baseName = fileInfo.completeBaseName();
@@ -334,9 +836,9 @@ QString MainWindow::loadLyrics(const QString &filePath) const noexcept {
     //qDebug() << "LRC文件是否存在:" << lrcFile.exists();
     if (lrcFile.exists() && lrcFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QTextStream in(&lrcFile);
-        QString lyrics = in.readAll();
+        const Lyrics parsed = Lyrics::parse(in.readAll());
         lrcFile.close();
-        return lyrics;
+        return parsed;
     }
     QString txtPath = dirPath + "/" + baseName + ".txt";
     QFile txtFile(txtPath);
@@ -344,11 +846,11 @@ QString MainWindow::loadLyrics(const QString &filePath) const noexcept {
     //qDebug() << "TXT文件是否存在:" << txtFile.exists();
     if (txtFile.exists() && txtFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         QTextStream in(&txtFile);
-        QString lyrics = in.readAll();
+        const Lyrics parsed = Lyrics::parse(in.readAll());
         txtFile.close();
-        return lyrics;
+        return parsed;
     }
-    return QString();
+    return Lyrics();
 }
 
 void MainWindow::onPlaylistClicked(const QModelIndex& index) noexcept {
@@ -356,11 +858,21 @@ void MainWindow::onPlaylistClicked(const QModelIndex& index) noexcept {
      * 处理播放列表视图的点击事件。当用户点击某一行时，如果点击的是删除按钮，则调用 removeTrack() 删除该曲目；否则调用 playTrack() 播放选中的曲目。
      */
     if (index.isValid()) {
-        if(index.column() == PlaylistModel::Delete) playlistModel.removeTrack(index.row());
-        else playTrack(index.row());
+        const int row = playlistProxy.mapToSource(index).row();
+        if(index.column() == PlaylistModel::Delete) playlistModel.removeTrack(row);
+        else playTrack(row);
     }
 }
 
+void MainWindow::removeSelectedTracks() noexcept {
+    /*
+     * 删除播放列表中选中的所有行，整批交给模型一次完成
+     */
+    std::vector<int> rows;
+    for (const QModelIndex& index : ui->music_list->selectionModel()->selectedRows()) rows.push_back(playlistProxy.mapToSource(index).row());
+    playlistModel.removeTracks(std::move(rows));
+}
+
 void MainWindow::updateDurationDisplay() noexcept {
     /*
      * 更新播放器的总时长显示。它会获取当前播放器的总时长（以毫秒为单位），并将其格式化为“分钟:秒”形式的字符串，然后设置到界面上的 total_duration 标签中。
@@ -456,15 +968,15 @@ void MainWindow::toggleMuted() noexcept {
         muted = false;
         ui->mute->setIcon(QIcon(":/assets/material-symbols--volume-up-rounded.png"));
         ui->mute->setToolTip("静音");
-        audio.setVolume(volume_ / 100.0f);
+        player.setVolume(volume_ / 100.0f);
         ui->volume->setValue(volume_);
     }
     else {
         muted = true;
         ui->mute->setIcon(QIcon(":/assets/material-symbols--volume-off-rounded.png"));
         ui->mute->setToolTip("取消静音");
-        volume_ = audio.volume() * 100;
-        audio.setVolume(0.0f);
+        volume_ = player.volume() * 100;
+        player.setVolume(0.0f);
         ui->volume->setValue(0);
     }
 }
@@ -481,48 +993,64 @@ void MainWindow::dropEvent(QDropEvent* ev) noexcept {
      * 处理拖放事件，将拖入的本地文件或文件夹添加到播放列表模型中。
      */
     const auto urls = ev->mimeData()->urls();
+    QStringList files;
     for (const auto& u : urls) {
         if (!u.isLocalFile()) continue;
         const QString path = u.toLocalFile();
         QFileInfo info(path);
-        if (info.isDir()) {
-            QDirIterator it(path, QDir::Files | QDir::NoSymLinks, QDirIterator::Subdirectories);
-            while (it.hasNext()) {
-                const QString file = it.next();
-                playlistModel.addMusicFile(file);
-            }
-        }
-        else playlistModel.addMusicFile(path);
+        if (info.isDir()) playlistModel.addMusicFolder(path);
+        else files << path;
     }
+    playlistModel.addMusicFiles(files);
     ev->acceptProposedAction();
 }
 
 void MainWindow::playModeClicked() noexcept {
     /*
-     * 切换播放模式。它会根据当前的播放模式（顺序、循环、随机）来切换到下一个模式，并更新按钮图标和提示文本。
+     * 切换播放模式。它会根据当前的播放模式（顺序、循环、随机）来切换到下一个模式，并更新按钮图标和提示文本。模式会被保存
      */
     switch(playlistModel.playMode) {
     case PlaylistModel::Ordered:
         playlistModel.playMode = PlaylistModel::Looped;
-        ui->play_mode->setIcon(QIcon(":/assets/material-symbols--repeat-one-rounded.png"));
-        ui->play_mode->setToolTip("单曲循环");
         break;
-    case PlaylistModel::Looped: {
+    case PlaylistModel::Looped:
         playlistModel.playMode = PlaylistModel::Shuffled;
-        ui->play_mode->setIcon(QIcon(":/assets/material-symbols--shuffle-rounded.png"));
-        ui->play_mode->setToolTip("随机播放");
-        playlistModel.shuffle();
-        shuffleIndex = 0;
+        restartShuffle();
         break;
-    }
     case PlaylistModel::Shuffled:
         playlistModel.playMode = PlaylistModel::Ordered;
+        break;
+    }
+    QSettings().setValue("playback/mode", int(playlistModel.playMode));
+    updatePlayModeButton();
+    refreshNextTrack();
+}
+
+void MainWindow::updatePlayModeButton() noexcept {
+    switch(playlistModel.playMode) {
+    case PlaylistModel::Ordered:
         ui->play_mode->setIcon(QIcon(":/assets/material-symbols--playlist-play-rounded.png"));
         ui->play_mode->setToolTip("列表顺序播放");
         break;
+    case PlaylistModel::Looped:
+        ui->play_mode->setIcon(QIcon(":/assets/material-symbols--repeat-one-rounded.png"));
+        ui->play_mode->setToolTip("单曲循环");
+        break;
+    case PlaylistModel::Shuffled:
+        ui->play_mode->setIcon(QIcon(":/assets/material-symbols--shuffle-rounded.png"));
+        ui->play_mode->setToolTip("随机播放");
+        break;
     }
 }
 
+void MainWindow::restartShuffle() noexcept {
+    /*
+     * 重新洗牌开始新的一轮，正在播放的曲目算作这一轮的第一首
+     */
+    playlistModel.shuffle();
+    if (currentTrackIndex >= 0) playlistModel.shufflePlayed(currentTrackIndex);
+}
+
 void MainWindow::playerDurationChanged(qint64 d) noexcept {
     /*
      * 更新播放器的总时长显示。它会将播放器的总时长（以毫秒为单位）设置到音乐进度条的范围，并更新总时长标签的文本。
@@ -534,23 +1062,58 @@ void MainWindow::playerDurationChanged(qint64 d) noexcept {
 void MainWindow::playerPositionChanged(qint64 p) noexcept {
     /*
      * 更新播放器的当前位置显示。它会将播放器的当前位置（以毫秒为单位）设置到音乐进度条的值，并更新当前时长标签的文本。
+     * 窗口最小化或隐藏到托盘时不更新，恢复显示时由 changeEvent 补上
      */
+    if (!isVisible() || isMinimized()) return;
     ui->music_progress->setValue(int(p));
     ui->current_duration->setText(formatTime(p));
+    highlightLyrics(p);
 }
 
 void MainWindow::playerMediaStatusChanged(QMediaPlayer::MediaStatus status) noexcept {
     /*
      * 处理播放器的媒体状态变化。当媒体状态变为已加载（Loaded）时，更新播放器的总时长显示；当媒体状态变为结束（EndOfMedia）时，自动切换到下一首曲目。
      */
-    if (status == QMediaPlayer::EndOfMedia) nextTrack();
+    if (status != QMediaPlayer::EndOfMedia) return;
+    closeHistory(true);
+    nextTrack();
+}
+
+void MainWindow::historyRecorded(const PlayHistory::Event& event) noexcept {
+    /*
+     * 播放历史中的每个事件都交给转移图，启动时重放日志中的事件，之后随播放逐个送入
+     */
+    if (event.type == PlayHistory::Play) transitions.played(event.path);
+    else transitions.finished(event.path, event.type == PlayHistory::Complete, event.position);
+}
+
+void MainWindow::closeHistory(bool completed) noexcept {
+    /*
+     * 给正在播放的曲目记上结束事件：自然播完记为播完，否则按切走时的位置记为跳过。
+     * 无缝切换时播放器已经换到下一首，播完的位置取列表中记录的时长
+     */
+    if (historyPath.isEmpty()) return;
+    if (completed) {
+        const auto track = playlistModel.getTrack(currentTrackIndex);
+        history.completed(historyPath, track && track->filePath == historyPath && track->duration > 0 ? track->duration : player.duration());
+    } else history.skipped(historyPath, player.position());
+    historyPath.clear();
+}
+
+void MainWindow::changeEvent(QEvent* event) {
+    /*
+     * 窗口从最小化恢复时，用播放器的当前位置刷新进度条、时间和歌词
+     */
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange && !isMinimized() && !ui->music_progress->isSliderDown())
+        playerPositionChanged(player.position());
 }
 
 void MainWindow::musicProgressPressed() noexcept {
     /*
      * 暂停播放器的 positionChanged 信号，以避免在用户拖动进度条时频繁更新当前时长显示。
      */
-    disconnect(&player, &QMediaPlayer::positionChanged, this, nullptr);
+    disconnect(&player, &AudioEngine::positionChanged, this, nullptr);
 }
 
 void MainWindow::musicProgressReleased() noexcept {
@@ -558,10 +1121,7 @@ void MainWindow::musicProgressReleased() noexcept {
      * 恢复播放器的 positionChanged 信号连接，以便在用户拖动进度条后继续更新当前时长显示。
      */
     player.setPosition(ui->music_progress->value());
-    connect(&player, &QMediaPlayer::positionChanged, this, [this](qint64 p){
-        ui->music_progress->setValue(int(p));
-        ui->current_duration->setText(formatTime(p));
-    });
+    connect(&player, &AudioEngine::positionChanged, this, &MainWindow::playerPositionChanged);
 }
 
 void MainWindow::musicProgressValueChanged(int value) noexcept {
@@ -585,7 +1145,7 @@ void MainWindow::volumeChanged(int v) noexcept {
         ui->mute->setIcon(QIcon(":/assets/material-symbols--volume-off-rounded.png"));
         ui->mute->setToolTip("取消静音");
     }
-    audio.setVolume(v / 100.0f);
+    player.setVolume(v / 100.0f);
 }
 
 MainWindow::~MainWindow() {
@@ -3,13 +3,23 @@
 
 #include <QMainWindow>
 #include <QMediaPlayer>
-#include <QAudioOutput>
 #include <QTextEdit>
 #include <QStackedWidget>
 #include <QMenu>
 #include <QSystemTrayIcon>
+#include <QProgressBar>
+#include <QToolButton>
+#include <QCache>
+#include <QDockWidget>
+#include <QListView>
 
 #include "playlistmodel.h"
+#include "playhistory.h"
+#include "playqueue.h"
+#include "transitiongraph.h"
+#include "coverresolver.h"
+#include "lyrics.h"
+#include "audioengine.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -31,24 +41,53 @@ private slots:
     void nextTrack() noexcept;
     void playTrack(int index) noexcept;
     void onPlaylistClicked(const QModelIndex& index) noexcept;
+    void removeSelectedTracks() noexcept;
     void updateDurationDisplay() noexcept;
     void toggleView() noexcept;
     void onTrayActivated(QSystemTrayIcon::ActivationReason reason) noexcept;
     void toggleMuted() noexcept;
     void dragEnterEvent(QDragEnterEvent *ev) noexcept;
+    void probeProgress(int done, int total) noexcept;
+    void scanProgress(int directories, int files) noexcept;
+    void scanFinished() noexcept;
+    void playlistDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight) noexcept;
+    void coverResolved(quint64 request, const QImage& image) noexcept;
+    void searchChanged(const QString& text) noexcept;
+    void prepareNextTrack() noexcept;
+    void refreshNextTrack() noexcept;
+    void playerSourceChanged(const QUrl& source) noexcept;
+    void setGapless(bool enabled) noexcept;
+    void sortPlaylist(int column, Qt::SortOrder order) noexcept;
+    void playlistRowsRemapped(const std::vector<int>& rows) noexcept;
+    void playlistTrackRemoved(int row, quint32 id) noexcept;
+    void playlistReset() noexcept;
 
 private:
     void setupPlaylist() noexcept;
+    void setupQueue() noexcept;
+    int followingTrack() noexcept;
+    float trackGain(int index) const noexcept;
+    void showTrack(int index) noexcept;
     void setupConnections() noexcept;
     void updatePlaybackButtons() noexcept;
     void updatePlayingInfo() noexcept;
     void setupLyricsView() noexcept;
     void updateLyricsDisplay() noexcept;
-    QString loadLyrics(const QString &filePath) const noexcept;
+    Lyrics loadLyrics(const QString &filePath) const noexcept;
+    void highlightLyrics(qint64 position) noexcept;
+    void formatLyricsLine(int line, int sung, bool active) noexcept;
     QString formatTime(qint64 milliseconds) const noexcept;
     void setupTray() noexcept;
+    void setupStatusBar() noexcept;
+    void setupPlaybackMenu() noexcept;
+    void setupLibraryMenu() noexcept;
     void dropEvent(QDropEvent* ev) noexcept;
+    void changeEvent(QEvent* event) override;
     void playModeClicked() noexcept;
+    void updatePlayModeButton() noexcept;
+    void restartShuffle() noexcept;
+    void closeHistory(bool completed) noexcept;
+    void historyRecorded(const PlayHistory::Event& event) noexcept;
     void playerDurationChanged(qint64 d) noexcept;
     void playerPositionChanged(qint64 p) noexcept;
     void playerMediaStatusChanged(QMediaPlayer::MediaStatus status) noexcept;
@@ -58,18 +97,38 @@ private:
     void volumeChanged(int v) noexcept;
 
     Ui::MainWindow* ui;
-    QAudioOutput audio;
-    QMediaPlayer player;
+    AudioEngine player;
     PlaylistModel playlistModel;
-    int currentTrackIndex, shuffleIndex;
+    PlaylistFilterProxy playlistProxy;
+    PlayQueue playQueue;
+    int currentTrackIndex;
+    int nextIndex{-1};
+    PlayHistory history;
+    QString historyPath;     // 已经记录开始、还没有记录跳过或播完的曲目
+    bool revisiting{false};  // 正在通过后退重新播放历史中的曲目
+    TransitionGraph transitions;
+    bool recommend{false};
+    bool gapless{true};
+    CoverResolver coverResolver;
+    quint64 coverRequest{0};
+
+    QDockWidget queueDock{"播放队列", this};
+    QListView queueView{this};
+    QAction actRemove{"从播放列表删除", this};
 
     QStackedWidget viewStack;
     QTextEdit lyricsDisplay;
     bool isLyricsView;
+    QCache<QString, Lyrics> lyricsCache{32};
+    Lyrics lyrics;
+    int lyricsLine{-1}, lyricsSung{-1};
 
     bool muted;
     int volume_;
 
+    QProgressBar probeBar{this};
+    QToolButton probeCancel{this};
+
     QSystemTrayIcon trayIcon{this};
     QMenu trayMenu{"播放控制", this};
     QAction actPrev{"上一曲", &trayMenu};
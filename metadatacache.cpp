@@ -0,0 +1,94 @@
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QList>
+#include <QDateTime>
+
+#include "metadatacache.h"
+
+MetadataCache::MetadataCache(StringPool& strings) noexcept : m_strings(strings) {}
+
+void MetadataCache::setDirectory(const QString& directory) noexcept {
+    m_directory = directory;
+}
+
+bool MetadataCache::load() noexcept {
+    /*
+     * 顺序读取整个缓存文件。魔数或版本不符时直接丢弃，之后所有曲目都会重新读取
+     */
+    m_entries.clear();
+    m_dirty = false;
+    QFile file{m_directory + "/metadata.cache"};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, count;
+    in >> magic >> version >> count;
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version) return false;
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count; i++) {
+        QString path, artist, album, coverKey;
+        Entry e;
+        in >> path >> e.size >> e.mtime >> e.duration >> e.title >> artist >> album >> coverKey >> e.trackNumber >> e.replayGain;
+        if (in.status() != QDataStream::Ok) {
+            m_entries.clear();
+            return false;
+        }
+        e.artist = m_strings.intern(artist);
+        e.album = m_strings.intern(album);
+        e.coverKey = m_strings.intern(coverKey);
+        m_entries.insert(path, e);
+    }
+    return true;
+}
+
+bool MetadataCache::save(const std::vector<QString>& playlist) noexcept {
+    /*
+     * 按播放列表顺序写出缓存，不在列表中的条目随之被清理
+     */
+    if (!m_dirty) return true;
+    QDir{}.mkpath(m_directory);
+    QSaveFile file{m_directory + "/metadata.cache"};
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out{&file};
+    out.setVersion(QDataStream::Qt_6_0);
+    QList<const QString*> paths;
+    paths.reserve(qsizetype(playlist.size()));
+    for (const QString& path : playlist) if (m_entries.contains(path)) paths.append(&path);
+    out << Magic << Version << quint32(paths.size());
+    for (const QString* path : paths) {
+        const Entry& e = m_entries[*path];
+        out << *path << e.size << e.mtime << e.duration << e.title << m_strings.at(e.artist) << m_strings.at(e.album) << m_strings.at(e.coverKey) << e.trackNumber << e.replayGain;
+    }
+    if (!file.commit()) return false;
+    m_dirty = false;
+    return true;
+}
+
+bool MetadataCache::lookup(MusicTrack& track) const noexcept {
+    /*
+     * 按路径查找，把缓存的元数据连同记录时的大小和修改时间填入 track。这里不访问文件，
+     * 调用方负责之后与文件的实际大小和修改时间核对（见 MetadataProber::enqueueChanged）
+     */
+    const auto it = m_entries.constFind(track.filePath);
+    if (it == m_entries.cend()) return false;
+    track.size = it->size;
+    track.mtime = it->mtime;
+    track.duration = it->duration;
+    track.title = it->title;
+    track.artist = m_strings.at(it->artist);
+    track.album = m_strings.at(it->album);
+    track.coverKey = m_strings.at(it->coverKey);
+    track.trackNumber = it->trackNumber;
+    track.replayGain = it->replayGain;
+    return true;
+}
+
+void MetadataCache::store(const MusicTrack& track) noexcept {
+    /*
+     * 记录一次新的读取结果
+     */
+    m_entries.insert(track.filePath, Entry{track.size, track.mtime, track.duration, track.title, m_strings.intern(track.artist), m_strings.intern(track.album), m_strings.intern(track.coverKey), track.trackNumber, track.replayGain});
+    m_dirty = true;
+}
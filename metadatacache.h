@@ -0,0 +1,41 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+
+#include "musictrack.h"
+#include "stringpool.h"
+
+class MetadataCache {
+public:
+    explicit MetadataCache(StringPool& strings) noexcept;
+
+    void setDirectory(const QString& directory) noexcept;
+    bool load() noexcept;
+    bool save(const std::vector<QString>& paths) noexcept;
+
+    bool lookup(MusicTrack& track) const noexcept;
+    void store(const MusicTrack& track) noexcept;
+
+private:
+    struct Entry {
+        qint64 size, mtime, duration;
+        QString title;
+        quint32 artist, album, coverKey;  // 驻留池中的编号，同一艺术家和专辑只保存一份
+        qint32 trackNumber;
+        float replayGain;
+    };
+
+    static constexpr quint32 Magic = 0x574D4331; // "WMC1"
+    static constexpr quint32 Version = 4;
+
+    StringPool& m_strings;
+    QString m_directory;
+    QHash<QString, Entry> m_entries;
+    bool m_dirty{false};
+};
+
+#endif // METADATACACHE_H
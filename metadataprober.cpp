@@ -0,0 +1,150 @@
+#include <algorithm>
+
+#include <QThread>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUrl>
+#include <QMediaPlayer>
+#include <QMediaMetaData>
+#include <QDateTime>
+
+#include "metadataprober.h"
+#include "tagreader.h"
+
+MetadataProber::MetadataProber(QObject* parent) noexcept : QObject(parent) {
+    /*
+     * 工作线程数与逻辑核心数一致
+     */
+    pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+MetadataProber::~MetadataProber() {
+    cancel();
+    pool.waitForDone();
+}
+
+void MetadataProber::enqueue(const QStringList& paths) noexcept {
+    /*
+     * 把一批文件交给线程池读取元数据，结果通过 trackProbed 信号回到主线程
+     */
+    if (paths.isEmpty()) return;
+    total += paths.size();
+    emit progressChanged(done, total);
+    const quint64 gen = generation.load();
+    for (const QString& path : paths) pool.start([this, path, gen] {
+        if (generation.load() != gen) return;
+        const MusicTrack track = probe(path, coverStore);
+        QMetaObject::invokeMethod(this, [this, track, gen] { deliver(track, gen); }, Qt::QueuedConnection);
+    });
+}
+
+void MetadataProber::enqueueChanged(const std::vector<FileStamp>& files) noexcept {
+    /*
+     * 直接从元数据缓存取出的曲目还没有与文件核对过。在一个工作线程中逐个比较大小和修改时间，
+     * 有变化的（包括已经不存在的）回到主线程后交给 enqueue 重新读取，没有变化的不计入进度
+     */
+    if (files.empty()) return;
+    const quint64 gen = generation.load();
+    pool.start([this, files, gen] {
+        QStringList changed;
+        for (const FileStamp& file : files) {
+            if (generation.load() != gen) return;
+            const QFileInfo info(file.path);
+            if (info.size() != file.size || info.lastModified().toMSecsSinceEpoch() != file.mtime) changed << file.path;
+        }
+        if (changed.isEmpty()) return;
+        QMetaObject::invokeMethod(this, [this, changed, gen] { if (gen == generation.load()) enqueue(changed); }, Qt::QueuedConnection);
+    });
+}
+
+void MetadataProber::cancel() noexcept {
+    /*
+     * 丢弃尚未开始的任务，正在运行的任务结果会因代号不符而被忽略
+     */
+    generation++;
+    pool.clear();
+    const bool wasBusy = total > 0;
+    done = total = 0;
+    if (wasBusy) {
+        emit progressChanged(0, 0);
+        emit finished();
+    }
+}
+
+bool MetadataProber::isBusy() const noexcept {
+    return total > 0;
+}
+
+void MetadataProber::setCoverStore(const CoverStore* store) noexcept {
+    /*
+     * 设置后，读取到的封面会在工作线程中存入封面库，结果中只带回封面引用
+     */
+    coverStore = store;
+}
+
+void MetadataProber::deliver(const MusicTrack& track, quint64 gen) noexcept {
+    /*
+     * 在主线程中转发读取结果并更新进度
+     */
+    if (gen != generation.load()) return;
+    done++;
+    emit trackProbed(track);
+    emit progressChanged(done, total);
+    if (done >= total) {
+        done = total = 0;
+        emit finished();
+    }
+}
+
+MusicTrack MetadataProber::probe(const QString& path, const CoverStore* covers) noexcept {
+    /*
+     * 读取单个文件的元数据：先用 TagReader 直接解析标签，解析不了的格式再交给 QMediaPlayer
+     */
+    MusicTrack track(path);
+    QByteArray coverData;
+    if (TagReader::read(path, track, &coverData)) {
+        if (covers != nullptr) track.coverKey = covers->insert(coverData);
+    }
+    else {
+        QImage cover;
+        track = probeWithPlayer(path, covers != nullptr ? &cover : nullptr);
+        if (covers != nullptr) track.coverKey = covers->insert(cover);
+    }
+    const QFileInfo info(path);
+    track.size = info.size();
+    track.mtime = info.lastModified().toMSecsSinceEpoch();
+    return track;
+}
+
+MusicTrack MetadataProber::probeWithPlayer(const QString& path, QImage* cover) noexcept {
+    /*
+     * 用 QMediaPlayer 读取单个文件的元数据。在工作线程中阻塞运行，出错或超时后返回占位信息
+     */
+    MusicTrack track(path);
+    QMediaPlayer probe;
+    QEventLoop loop;
+    QObject::connect(&probe, &QMediaPlayer::metaDataChanged, &loop, &QEventLoop::quit);
+    QObject::connect(&probe, &QMediaPlayer::errorOccurred, &loop, &QEventLoop::quit);
+    QObject::connect(&probe, &QMediaPlayer::mediaStatusChanged, &loop, [&loop](QMediaPlayer::MediaStatus status) {
+        if (status == QMediaPlayer::InvalidMedia) loop.quit();
+    });
+    QTimer::singleShot(5000, &loop, &QEventLoop::quit);
+    probe.setSource(QUrl::fromLocalFile(path));
+    loop.exec();
+    const QMediaMetaData meta = probe.metaData();
+    track.duration = probe.duration();
+    if (cover != nullptr) {
+        *cover = meta.value(QMediaMetaData::CoverArtImage).value<QImage>();
+        if (cover->isNull()) *cover = meta.value(QMediaMetaData::ThumbnailImage).value<QImage>();
+    }
+    const QString title = meta.stringValue(QMediaMetaData::Title);
+    if (!title.isEmpty()) track.title = title;
+    QString artist = meta.stringValue(QMediaMetaData::Author);
+    if (artist.isEmpty()) artist = meta.stringValue(QMediaMetaData::AlbumArtist);
+    if (artist.isEmpty()) artist = meta.stringValue(QMediaMetaData::ContributingArtist);
+    if (!artist.isEmpty()) track.artist = artist;
+    const QString album = meta.stringValue(QMediaMetaData::AlbumTitle);
+    if (!album.isEmpty()) track.album = album;
+    track.trackNumber = std::max(0, meta.value(QMediaMetaData::TrackNumber).toInt());
+    return track;
+}
@@ -0,0 +1,49 @@
+#ifndef METADATAPROBER_H
+#define METADATAPROBER_H
+
+#include <atomic>
+#include <vector>
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "musictrack.h"
+#include "coverstore.h"
+
+class MetadataProber : public QObject {
+    Q_OBJECT
+
+public:
+    explicit MetadataProber(QObject* parent = nullptr) noexcept;
+    ~MetadataProber();
+
+    struct FileStamp {
+        QString path;
+        qint64 size, mtime;
+    };
+
+    void enqueue(const QStringList& paths) noexcept;
+    void enqueueChanged(const std::vector<FileStamp>& files) noexcept;
+    void cancel() noexcept;
+    bool isBusy() const noexcept;
+    void setCoverStore(const CoverStore* store) noexcept;
+
+    static MusicTrack probe(const QString& path, const CoverStore* covers = nullptr) noexcept;
+    static MusicTrack probeWithPlayer(const QString& path, QImage* cover = nullptr) noexcept;
+
+signals:
+    void trackProbed(const MusicTrack& track);
+    void progressChanged(int done, int total);
+    void finished();
+
+private:
+    void deliver(const MusicTrack& track, quint64 generation) noexcept;
+
+    QThreadPool pool;
+    const CoverStore* coverStore{nullptr};
+    std::atomic<quint64> generation{0};
+    int done{0}, total{0};
+};
+
+#endif // METADATAPROBER_H
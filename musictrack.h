@@ -0,0 +1,27 @@
+#ifndef MUSICTRACK_H
+#define MUSICTRACK_H
+
+#include <limits>
+
+#include <QString>
+#include <QFileInfo>
+
+struct MusicTrack {
+    QString filePath, title, artist, album;
+    qint64 duration;
+    QString coverKey;
+    qint64 size{0}, mtime{0};
+    int trackNumber{0};  // 专辑内的音轨号，标签中没有时为 0
+    float replayGain{std::numeric_limits<float>::quiet_NaN()};  // 标签中的曲目增益（dB），没有时为 NaN
+    quint32 id{0};  // 播放列表分配的编号，在本次运行中保持不变，用于索引和过滤
+
+    MusicTrack() noexcept : duration(0) {}
+
+    /*
+     * 只填入占位信息，真正的元数据由 MetadataProber 在后台线程读取后回填
+     */
+    explicit MusicTrack(const QString& path) noexcept :
+        filePath(path), title(QFileInfo(path).baseName()), artist(QStringLiteral("未知艺术家")), album(QStringLiteral("未知专辑")), duration(0) {}
+};
+
+#endif // MUSICTRACK_H
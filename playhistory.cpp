@@ -0,0 +1,248 @@
+#include <limits>
+#include <utility>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "playhistory.h"
+
+namespace {
+
+void syncToDisk(QFile& file) noexcept {
+    /*
+     * QFile::flush 只把数据交给系统，这里再要求系统写到磁盘上
+     */
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+}
+
+PlayHistory::PlayHistory(QObject* parent) noexcept : QObject(parent) {
+    m_pool.setMaxThreadCount(1);
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FlushInterval);
+    connect(&m_flushTimer, &QTimer::timeout, this, &PlayHistory::flush);
+}
+
+PlayHistory::~PlayHistory() {
+    flush();
+    m_pool.waitForDone();
+}
+
+void PlayHistory::setDirectory(const QString& directory) noexcept {
+    m_directory = directory;
+}
+
+bool PlayHistory::load() noexcept {
+    /*
+     * 按顺序重放日志，用开始播放的事件重建 LRU 链表。日志中的路径编号只在写入它的那次运行中有效，
+     * 读取时换成本次的编号。末尾不完整（写入时崩溃）或格式不对时保留已读出的部分，并在后台重写一份干净的日志；
+     * 重复的定义记录过多或事件过多时同样压缩
+     */
+    QFile file{m_directory + "/history.log"};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version) {
+        compact();
+        return false;
+    }
+    constexpr quint32 Unknown = std::numeric_limits<quint32>::max();
+    std::vector<quint32> remap;
+    size_t defines = 0;
+    bool damaged = false;
+    while (!in.atEnd()) {
+        quint8 type;
+        quint32 id;
+        in >> type >> id;
+        if (type == Define) {
+            QString path;
+            in >> path;
+            if (in.status() != QDataStream::Ok || path.isEmpty()) {
+                damaged = true;
+                break;
+            }
+            if (id >= remap.size()) remap.resize(size_t(id) + 1, Unknown);
+            remap[id] = m_paths.intern(path);
+            defines++;
+            continue;
+        }
+        Event event;
+        in >> event.time >> event.position;
+        if (in.status() != QDataStream::Ok || type > Complete || id >= remap.size() || remap[id] == Unknown) {
+            damaged = true;
+            break;
+        }
+        event.path = remap[id];
+        event.type = EventType(type);
+        m_events.push_back(event);
+        if (event.type == Play) touch(event.path);
+    }
+    file.close();
+    if (damaged || m_events.size() > MaxEvents || defines > 2 * size_t(m_paths.size()) + 64) compact();
+    return !damaged;
+}
+
+void PlayHistory::flush() noexcept {
+    /*
+     * 把缓冲的记录交给后台线程追加到日志末尾，一批只同步一次磁盘
+     */
+    m_flushTimer.stop();
+    if (m_buffer.isEmpty()) return;
+    const QString directory = m_directory;
+    m_pool.start([directory, data = std::exchange(m_buffer, QByteArray())] {
+        QDir{}.mkpath(directory);
+        QFile file{directory + "/history.log"};
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) return;
+        if (file.size() == 0) {
+            QDataStream out{&file};
+            out.setVersion(QDataStream::Qt_6_0);
+            out << Magic << Version;
+        }
+        file.write(data);
+        syncToDisk(file);
+    });
+}
+
+void PlayHistory::played(const QString& path) noexcept {
+    /*
+     * 开始播放一首曲目：记录事件并移到 LRU 链表头部，结束之前的后退
+     */
+    touch(record(Play, path, 0));
+    m_cursor = -1;
+}
+
+void PlayHistory::revisited(const QString& path) noexcept {
+    /*
+     * 通过后退重新播放：只记录事件，不改变链表顺序，连续后退才能一直往更早的曲目走
+     */
+    record(Play, path, 0);
+}
+
+void PlayHistory::skipped(const QString& path, qint64 position) noexcept {
+    record(Skip, path, position);
+}
+
+void PlayHistory::completed(const QString& path, qint64 position) noexcept {
+    record(Complete, path, position);
+}
+
+QStringList PlayHistory::recent(int count) const noexcept {
+    /*
+     * 从最近到最早列出至多 count 首曲目的路径
+     */
+    QStringList paths;
+    for (qint32 id = m_head; id >= 0 && paths.size() < count; id = m_nodes[id].next) paths.append(m_paths.at(id));
+    return paths;
+}
+
+QString PlayHistory::back() noexcept {
+    /*
+     * 返回后退位置之前（更早）的一首并把后退位置移过去，已经到最早的一首时返回空字符串
+     */
+    const qint32 from = m_cursor >= 0 ? m_cursor : m_head;
+    if (from < 0 || m_nodes[from].next < 0) return QString();
+    m_cursor = m_nodes[from].next;
+    return m_paths.at(m_cursor);
+}
+
+quint32 PlayHistory::record(EventType type, const QString& path, qint64 position) noexcept {
+    /*
+     * 事件追加到内存和写入缓冲。路径在本次运行中第一次出现时先写一条定义记录；
+     * 缓冲攒够一批时立即落盘，否则等定时器，事件过多时改为整体压缩
+     */
+    const quint32 id = m_paths.intern(path);
+    if (id >= m_defined.size()) m_defined.resize(size_t(id) + 1, false);
+    QDataStream out{&m_buffer, QIODevice::WriteOnly | QIODevice::Append};
+    out.setVersion(QDataStream::Qt_6_0);
+    if (!m_defined[id]) {
+        writeDefine(out, id, path);
+        m_defined[id] = true;
+    }
+    const Event event{QDateTime::currentMSecsSinceEpoch(), id, quint32(qBound<qint64>(0, position, std::numeric_limits<quint32>::max())), type};
+    m_events.push_back(event);
+    writeEvent(out, event);
+    emit recorded(event);
+    if (m_events.size() > MaxEvents + MaxEvents / 2) compact();
+    else if (m_buffer.size() >= FlushBytes) flush();
+    else if (!m_flushTimer.isActive()) m_flushTimer.start();
+    return id;
+}
+
+void PlayHistory::touch(quint32 id) noexcept {
+    /*
+     * 移到链表头部，超出容量时淘汰链表尾部最久没有播放的曲目
+     */
+    if (id >= m_nodes.size()) m_nodes.resize(m_paths.size());
+    if (m_head == qint32(id)) return;
+    if (m_nodes[id].linked) unlink(id);
+    Node& node = m_nodes[id];
+    node.prev = -1;
+    node.next = m_head;
+    node.linked = true;
+    if (m_head >= 0) m_nodes[m_head].prev = qint32(id);
+    else m_tail = qint32(id);
+    m_head = qint32(id);
+    if (++m_linked > Capacity) unlink(quint32(m_tail));
+}
+
+void PlayHistory::unlink(quint32 id) noexcept {
+    Node& node = m_nodes[id];
+    (node.prev >= 0 ? m_nodes[node.prev].next : m_head) = node.next;
+    (node.next >= 0 ? m_nodes[node.next].prev : m_tail) = node.prev;
+    node = Node{};
+    m_linked--;
+    if (m_cursor == qint32(id)) m_cursor = -1;
+}
+
+void PlayHistory::compact() noexcept {
+    /*
+     * 只保留最近 MaxEvents 个事件和它们引用的路径。主线程截取快照，序列化和写盘在后台线程进行；
+     * 尚未落盘的缓冲已经包含在快照中，直接丢弃，之后的追加排在重写之后执行
+     */
+    if (m_events.size() > MaxEvents) m_events.erase(m_events.begin(), m_events.end() - MaxEvents);
+    m_defined.assign(m_paths.size(), false);
+    std::vector<std::pair<quint32, QString>> paths;
+    for (const Event& event : m_events) {
+        if (m_defined[event.path]) continue;
+        m_defined[event.path] = true;
+        paths.emplace_back(event.path, m_paths.at(event.path));
+    }
+    m_buffer.clear();
+    m_flushTimer.stop();
+    const QString directory = m_directory;
+    m_pool.start([directory, paths = std::move(paths), events = m_events] {
+        QDir{}.mkpath(directory);
+        QSaveFile file{directory + "/history.log"};
+        if (!file.open(QIODevice::WriteOnly)) return;
+        QDataStream out{&file};
+        out.setVersion(QDataStream::Qt_6_0);
+        out << Magic << Version;
+        for (const auto& [id, path] : paths) writeDefine(out, id, path);
+        for (const Event& event : events) writeEvent(out, event);
+        file.commit();
+    });
+}
+
+void PlayHistory::writeDefine(QDataStream& out, quint32 id, const QString& path) noexcept {
+    out << quint8(Define) << id << path;
+}
+
+void PlayHistory::writeEvent(QDataStream& out, const Event& event) noexcept {
+    out << quint8(event.type) << event.path << event.time << event.position;
+}
@@ -0,0 +1,92 @@
+#ifndef PLAYHISTORY_H
+#define PLAYHISTORY_H
+
+#include <vector>
+
+#include <QObject>
+#include <QByteArray>
+#include <QDataStream>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "stringpool.h"
+
+/*
+ * 播放历史：最近播放过的曲目按路径组成 LRU 链表，用于“最近播放”菜单和随机模式下的后退；
+ * 播放、跳过和播完事件追加写入二进制日志，攒够一批或定时落盘，过长时在后台线程压缩重写
+ */
+class PlayHistory : public QObject {
+    Q_OBJECT
+
+public:
+    enum EventType : quint8 {
+        Define = 0,  // 日志中为路径分配编号，不是播放事件
+        Play,
+        Skip,
+        Complete
+    };
+
+    struct Event {
+        qint64 time;        // 发生时间，自纪元起的毫秒数
+        quint32 path;       // 路径在 path() 中的编号
+        quint32 position;   // 跳过或播完时的播放位置（毫秒），开始播放时为 0
+        EventType type;
+    };
+
+    explicit PlayHistory(QObject* parent = nullptr) noexcept;
+    ~PlayHistory();
+
+    void setDirectory(const QString& directory) noexcept;
+    bool load() noexcept;
+    void flush() noexcept;
+
+    void played(const QString& path) noexcept;
+    void revisited(const QString& path) noexcept;
+    void skipped(const QString& path, qint64 position) noexcept;
+    void completed(const QString& path, qint64 position) noexcept;
+
+    QStringList recent(int count) const noexcept;
+    QString back() noexcept;
+
+    const std::vector<Event>& events() const noexcept { return m_events; }
+    const QString& path(quint32 id) const noexcept { return m_paths.at(id); }
+
+signals:
+    void recorded(const PlayHistory::Event& event);
+
+private:
+    struct Node {
+        qint32 prev{-1}, next{-1};
+        bool linked{false};
+    };
+
+    quint32 record(EventType type, const QString& path, qint64 position) noexcept;
+    void touch(quint32 id) noexcept;
+    void unlink(quint32 id) noexcept;
+    void compact() noexcept;
+
+    static void writeDefine(QDataStream& out, quint32 id, const QString& path) noexcept;
+    static void writeEvent(QDataStream& out, const Event& event) noexcept;
+
+    static constexpr quint32 Magic = 0x57484931; // "WHI1"
+    static constexpr quint32 Version = 1;
+    static constexpr int Capacity = 1000;         // LRU 中最多保留的曲目数
+    static constexpr size_t MaxEvents = 100000;   // 压缩后保留的事件数
+    static constexpr int FlushBytes = 4096;       // 缓冲攒到这么多字节时立即落盘
+    static constexpr int FlushInterval = 5000;    // 否则最多延迟这么多毫秒
+
+    QString m_directory;
+    StringPool m_paths;
+    std::vector<Node> m_nodes;      // 按路径编号的链表节点，链表头是最近播放的曲目
+    qint32 m_head{-1}, m_tail{-1};
+    int m_linked{0};
+    qint32 m_cursor{-1};            // 后退时所在的节点，-1 表示还没有后退
+    std::vector<Event> m_events;
+    std::vector<bool> m_defined;    // 本次运行中已经写过定义记录的路径编号
+    QByteArray m_buffer;            // 尚未落盘的记录
+    QTimer m_flushTimer;
+    QThreadPool m_pool;             // 只有一个线程，追加和压缩按提交顺序执行
+};
+
+#endif // PLAYHISTORY_H
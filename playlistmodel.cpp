@@ -1,5 +1,6 @@
 #include <algorithm>
-#include <random>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 #include <QDir>
@@ -10,24 +11,150 @@
 #include <QStandardPaths>
 #include <QDebug>
 #include <QPushButton>
+#include <QSettings>
+#include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
 
 #include "playlistmodel.h"
 
+namespace {
+
+constexpr size_t ParallelSortThreshold = 50000;
+
+/*
+ * 排序时每行的全部键，艺术家和专辑是驻留池中的名次，比较时只有标题需要比较排序键
+ */
+struct SortEntry {
+    quint32 artist, album;
+    qint32 number, duration;
+    const QCollatorSortKey* title;
+    int row;
+};
+
+QString shuffleFileName(int playlist) noexcept {
+    /*
+     * 随机队列的状态按播放列表的序号分文件保存，删除列表后靠后的文件随序号前移
+     */
+    return QString("shuffle-%1.state").arg(playlist);
+}
+
+float shuffleWeight(qint64 mtime) noexcept {
+    /*
+     * 按权重随机播放时，最近加入或修改的文件更容易排在前面：权重每过 180 天减半，最低 0.25，时间未知时按 1 计
+     */
+    if (mtime <= 0) return 1.0f;
+    const double days = double(QDateTime::currentMSecsSinceEpoch() - mtime) / 86400000.0;
+    return float(std::max(0.25, std::exp2(-std::max(0.0, days) / 180.0)));
+}
+
+template <typename T, typename Less>
+void parallelStableSort(std::vector<T>& items, Less less) {
+    /*
+     * 小表直接排序。大表切成 2 的幂个段，在线程池中各自稳定排序，再逐层两两归并；std::inplace_merge 同样是稳定的
+     */
+    const int threads = QThread::idealThreadCount();
+    if (items.size() < ParallelSortThreshold || threads < 2) {
+        std::stable_sort(items.begin(), items.end(), less);
+        return;
+    }
+    int parts = 1;
+    while (parts * 2 <= threads) parts *= 2;
+    std::vector<size_t> bounds(parts + 1);
+    for (int i = 0; i <= parts; i++) bounds[i] = items.size() * i / parts;
+    const auto begin = items.begin();
+    QThreadPool pool;
+    pool.setMaxThreadCount(parts);
+    for (int i = 0; i < parts; i++) pool.start([=, &bounds] { std::stable_sort(begin + bounds[i], begin + bounds[i + 1], less); });
+    pool.waitForDone();
+    for (int width = 1; width < parts; width *= 2) {
+        for (int i = 0; i + width < parts; i += width * 2) {
+            pool.start([=, &bounds] { std::inplace_merge(begin + bounds[i], begin + bounds[i + width], begin + bounds[std::min(i + width * 2, parts)], less); });
+        }
+        pool.waitForDone();
+    }
+}
+
+}
+
 PlaylistModel::PlaylistModel(QWidget* parent) noexcept : QAbstractTableModel(parent), parent(parent) {
     /*
      * 支持的音乐格式列表
      */
     m_supportedFormats << "mp3" << "flac" << "aac" << "wav" << "m4a" << "ogg" << "wma" << "mgg";
-    connect(this, &PlaylistModel::playlistChanged, this, &PlaylistModel::savePlayList);
-    qDebug() << "播放列表保存于：" << defaultPath();
+    m_scanner.setSuffixes(m_supportedFormats);
+    connect(&m_scanner, &FolderScanner::filesFound, this, &PlaylistModel::addMusicFiles);
+    connect(&m_scanner, &FolderScanner::progressChanged, this, &PlaylistModel::scanProgress);
+    connect(&m_scanner, &FolderScanner::finished, this, &PlaylistModel::scanFinished);
+    /*
+     * 监视导入过的文件夹，把增删改同步到播放列表
+     */
+    m_roots = QSettings().value("library/folders").toStringList();
+    m_watcher.setSuffixes(m_supportedFormats);
+    m_watcher.setRoots(m_roots);
+    m_watcher.setSnapshot([this](const QSet<QString>& directories) {
+        QList<LibraryWatcher::FileState> states;
+        QStringList missing;
+        for (int row = 0; row < m_tracks.size(); row++) {
+            const QString& path = m_tracks.path(row);
+            if (!directories.contains(path.left(path.lastIndexOf('/')))) continue;
+            if (!m_tracks.resolved(row) && !resolveRow(row)) missing << path;
+            else states.append(LibraryWatcher::FileState{path, m_tracks.fileSize(row), m_tracks.mtime(row)});
+        }
+        if (!missing.isEmpty()) m_prober.enqueue(missing);
+        return states;
+    });
+    connect(&m_watcher, &LibraryWatcher::changesDetected, this, &PlaylistModel::applyLibraryChanges);
+    /*
+     * 播放列表变化后延迟保存，连续的修改合并成一次写盘
+     */
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(1000);
+    connect(&m_saveTimer, &QTimer::timeout, this, &PlaylistModel::savePlayList);
+    connect(&m_saveTimer, &QTimer::timeout, this, &PlaylistModel::updateWatchedDirectories);
+    connect(this, &PlaylistModel::playlistChanged, &m_saveTimer, qOverload<>(&QTimer::start));
+    connect(&m_prober, &MetadataProber::trackProbed, this, &PlaylistModel::trackProbed);
+    connect(&m_prober, &MetadataProber::progressChanged, this, &PlaylistModel::probeProgress);
+    connect(&m_prober, &MetadataProber::finished, this, [this] {
+        m_library.setTracks(m_library.current(), m_tracks.paths(), m_pathKeys);
+        m_cache.save(m_library.paths());
+    });
+    m_cache.setDirectory(dataDirectory());
+    m_covers.setDirectory(dataDirectory() + "/covers");
+    m_covers.setMemoryBudget(QSettings().value("covers/memoryBudgetMB", 16).toLongLong() * 1024 * 1024);
+    m_prober.setCoverStore(&m_covers);
+    /*
+     * 后台分析响度、节拍和波形，结果单独保存，重启后只分析还没有结果的曲目
+     */
+    m_analysis.setDirectory(dataDirectory());
+    connect(&m_analyzer, &AnalysisScheduler::analyzed, this, &PlaylistModel::trackAnalyzed);
+    /*
+     * 随机播放队列随播放列表一起保存，重启后接着上次的一轮继续。保存位置在打开列表时设置
+     */
+    m_shuffle.setMode(ShuffleQueue::Mode(QSettings().value("playback/shuffleMode", int(ShuffleQueue::Uniform)).toInt()));
+    /*
+     * 各播放列表只保存曲目库中的编号
+     */
+    m_library.setDirectory(dataDirectory());
+    m_deleteIcon = QIcon(":/assets/material-symbols--delete-forever-rounded.png");
+    qDebug() << "播放列表保存于：" << dataDirectory() + "/library.bin";
+}
+
+PlaylistModel::~PlaylistModel() {
+    /*
+     * 退出前写出尚未保存的修改
+     */
+    if (m_saveTimer.isActive()) savePlayList();
+    else m_shuffle.save(m_tracks.ids());
+    m_analysis.save(m_library.paths());
 }
 
 int PlaylistModel::rowCount(const QModelIndex& parent) const {
     /*
-     * 返回播放列表中的音乐数量
+     * 返回已经交给视图的行数，超大的播放列表按需分批加入
      */
     Q_UNUSED(parent)
-    return m_tracks.size();
+    return m_loaded;
 }
 
 int PlaylistModel::columnCount(const QModelIndex& parent) const {
@@ -42,17 +169,27 @@ QVariant PlaylistModel::data(const QModelIndex& index, int role) const {
     /*
      * 返回播放列表中指定索引的音乐数据
      */
-    if (!index.isValid() || index.row() >= m_tracks.size()) return QVariant();
-    const MusicTrack& track = m_tracks.at(index.row());
+    if (!index.isValid() || index.row() >= m_loaded) return QVariant();
+    const int row = index.row();
     if (role == Qt::DisplayRole) switch (index.column()) {
         case Delete: return {};
-        case Title: return track.title;
-        case Artist: return track.artist;
-        case Album: return track.album;
-        case Duration: return formatDuration(track.duration);
+        case Title: return m_tracks.title(row);
+        case Artist: return m_tracks.artist(row);
+        case Album: return m_tracks.album(row);
+        case Duration: return formatDuration(m_tracks.duration(row));
+        case Loudness: {
+            const TrackAnalysis* result = rowAnalysis(row);
+            if (result == nullptr || std::isnan(result->loudness)) return QVariant();
+            return QString::number(result->loudness, 'f', 1) + " LUFS";
+        }
+        case Bpm: {
+            const TrackAnalysis* result = rowAnalysis(row);
+            if (result == nullptr || result->bpm <= 0.0f) return QVariant();
+            return QString::number(qRound(result->bpm));
+        }
         default: return QVariant();
     }
-    else if (role == Qt::DecorationRole && index.column() == Delete) return QIcon(":/assets/material-symbols--delete-forever-rounded.png");
+    else if (role == Qt::DecorationRole && index.column() == Delete) return m_deleteIcon;
     else if (role == Qt::ToolTipRole && index.column() == Delete) return "从库中移除音乐";
     return QVariant();
 }
@@ -67,6 +204,8 @@ QVariant PlaylistModel::headerData(int section, Qt::Orientation orientation, int
         case Artist: return "艺术家";
         case Album: return "专辑";
         case Duration: return "时长";
+        case Loudness: return "响度";
+        case Bpm: return "BPM";
         default: return QVariant();
     }
     return QVariant();
@@ -78,57 +217,219 @@ void PlaylistModel::addMusicFile(const QString& filePath) noexcept {
      */
     QFileInfo fileInfo(filePath);
     if (fileInfo.exists() && m_supportedFormats.contains(fileInfo.suffix().toLower())) {
-        for(int i = 0; i < m_tracks.size(); i++) if(m_tracks[i].filePath == filePath) {
+        const QString key = pathKey(filePath);
+        if (m_pathIndex.contains(key)) {
             QMessageBox::warning(parent, "文件已存在", "文件已经存在于播放列表中！");
             return;
         }
-        beginInsertRows(QModelIndex(), m_tracks.size(), m_tracks.size());
-        m_tracks.append(MusicTrack(filePath));
-        endInsertRows();
+        indexPath(filePath, key);
+        appendTracks({filePath});
+        m_prober.enqueue({filePath});
         emit playlistChanged();
     }
 }
 
+int PlaylistModel::addMusicFiles(const QStringList& filePaths) noexcept {
+    /*
+     * 批量添加音乐文件：跳过不支持的格式和重复文件，整批只通知视图一次、只触发一次保存，返回实际添加的数量
+     */
+    QStringList added;
+    for (const QString& filePath : filePaths) {
+        const QFileInfo fileInfo(filePath);
+        if (!m_supportedFormats.contains(fileInfo.suffix().toLower()) || !fileInfo.isFile()) continue;
+        const QString path = fileInfo.absoluteFilePath();
+        const QString key = pathKey(path);
+        if (m_pathIndex.contains(key)) continue;
+        indexPath(path, key);
+        added << path;
+    }
+    if (added.isEmpty()) return 0;
+    appendTracks(added);
+    m_prober.enqueue(added);
+    emit playlistChanged();
+    return added.size();
+}
+
 void PlaylistModel::addMusicFolder(const QString& folderPath) noexcept {
     /*
-     * 从指定文件夹中添加所有支持格式的音乐文件到播放列表
-     */
-    QDir dir(folderPath);
-    if (!dir.exists()) return;
-    QStringList filters;
-    for (int i = 0; i < m_supportedFormats.size(); i++) filters << QString("*.%1").arg(m_supportedFormats[i]);
-    QFileInfoList files = dir.entryInfoList(filters, QDir::Files);
-    if (!files.isEmpty()) for(int i = 0; i < files.size(); i++) {
-        bool exist = false;
-        for(int j = 0; j < m_tracks.size(); j++) if(m_tracks[j].filePath == files[i].filePath()) {
-            exist = true;
-            break;
-        }
-        if(!exist) {
-            beginInsertRows(QModelIndex(), m_tracks.size(), m_tracks.size());
-            m_tracks.append(MusicTrack(files[i].absoluteFilePath()));
-            endInsertRows();
-            emit playlistChanged();
-        }
+     * 在后台递归扫描指定文件夹，发现的音乐文件分批加入播放列表
+     */
+    const QFileInfo info(folderPath);
+    if (!info.isDir()) return;
+    const QString root = info.absoluteFilePath();
+    bool covered = false;
+    for (const QString& existing : m_roots) if (root == existing || root.startsWith(existing + "/")) covered = true;
+    if (!covered) {
+        m_roots << root;
+        QSettings().setValue("library/folders", m_roots);
+        m_watcher.setRoots(m_roots);
     }
+    m_scanner.scan(root);
+}
+
+void PlaylistModel::appendTracks(const QStringList& paths) noexcept {
+    /*
+     * 追加占位曲目。原先所有行都已交给视图时，新行紧接着显示（最多一批），否则等视图滚动到底部再取
+     */
+    const int first = m_tracks.size();
+    m_tracks.reserve(first + int(paths.size()));
+    for (const QString& path : paths) {
+        MusicTrack track(path);
+        registerTrack(track);
+        m_tracks.append(track);
+    }
+    if (m_loaded == first) exposeRows(isFiltering() ? m_tracks.size() : first + FetchBatch);
+}
+
+void PlaylistModel::exposeRows(int count) noexcept {
+    /*
+     * 把前 count 行交给视图，已经交出的行不受影响。交出之前先把其中的占位行从元数据缓存中取出
+     */
+    const int target = std::min(count, m_tracks.size());
+    if (target <= m_loaded) return;
+    materialize(m_loaded, target);
+    beginInsertRows(QModelIndex(), m_loaded, target - 1);
+    m_loaded = target;
+    endInsertRows();
+}
+
+void PlaylistModel::resetLoadedRows() noexcept {
+    /*
+     * 在模型重置期间调用：重新决定交给视图的行数并取出这些行，正在过滤时整个列表都要取出并重新搜索
+     */
+    m_loaded = isFiltering() ? m_tracks.size() : std::min(m_tracks.size(), FetchBatch);
+    materialize(0, m_loaded);
+    if (!isFiltering()) return;
+    m_filterMatches = m_search.search(m_filterTerms);
+    m_filterMatches.resize(m_nextId, false);
+}
+
+void PlaylistModel::openTracks(const std::vector<quint32>& ids) noexcept {
+    /*
+     * 按曲目库中的编号生成占位行，不访问文件。去重用库中保存的规范路径，与 addMusicFiles 和文件夹监视的判断一致
+     */
+    m_tracks.reserve(int(ids.size()));
+    for (const quint32 id : ids) {
+        const QString& path = m_library.path(id);
+        const QString& key = m_library.key(id);
+        if (m_pathIndex.contains(key)) continue;
+        indexPath(path, key);
+        MusicTrack track(path);
+        registerTrack(track);
+        m_tracks.append(track, false);
+    }
+}
+
+void PlaylistModel::materialize(int first, int last) noexcept {
+    /*
+     * 把 [first, last) 中的占位行从元数据缓存中取出，缓存中没有的交给读取线程。
+     * 过滤和排序时整个列表都要取出，所以这里只按路径查缓存，不在主线程访问文件；
+     * 取出的行在后台核对大小和修改时间，文件变过的再重新读取，结果经 trackProbed 回填
+     */
+    QStringList missing;
+    std::vector<MetadataProber::FileStamp> cached;
+    for (int row = first; row < last; row++) {
+        if (m_tracks.resolved(row)) continue;
+        if (resolveRow(row)) cached.push_back(MetadataProber::FileStamp{m_tracks.path(row), m_tracks.fileSize(row), m_tracks.mtime(row)});
+        else missing << m_tracks.path(row);
+    }
+    if (!missing.isEmpty()) m_prober.enqueue(missing);
+    m_prober.enqueueChanged(cached);
+}
+
+bool PlaylistModel::resolveRow(int row) noexcept {
+    /*
+     * 用缓存中的元数据填充一行占位曲目，编号保持不变。无论是否命中都标记为已处理，没有命中时返回 false。
+     * 只按路径查缓存，不核对文件
+     */
+    MusicTrack track(m_tracks.path(row));
+    m_tracks.setResolved(row, true);
+    if (!m_cache.lookup(track)) return false;
+    track.id = m_tracks.id(row);
+    updateTrack(row, track);
+    return true;
+}
+
+bool PlaylistModel::canFetchMore(const QModelIndex& parent) const {
+    return !parent.isValid() && m_loaded < m_tracks.size();
+}
+
+void PlaylistModel::fetchMore(const QModelIndex& parent) {
+    /*
+     * 视图滚动到已加载部分的底部时调用，每次多加入一批行
+     */
+    if (parent.isValid()) return;
+    exposeRows(m_loaded + FetchBatch);
+}
+
+void PlaylistModel::fetchUpTo(int index) noexcept {
+    /*
+     * 需要在视图中定位某一行（比如正在播放的曲目）时，先把它之前的行都交给视图
+     */
+    if (index >= m_loaded) exposeRows(index + 1);
 }
 
 void PlaylistModel::clearPlaylist() noexcept {
     /*
      * 清空播放列表中的所有音乐
      */
+    cancelImport();
     beginResetModel();
     m_tracks.clear();
+    m_loaded = 0;
+    m_titleKeys.clear();
+    m_pathIndex.clear();
+    m_pathKeys.clear();
+    m_search.clear();
+    m_shuffle.clear();
+    m_filterMatches.clear();
+    m_analyzer.clear();
     endResetModel();
     emit playlistChanged();
 }
 
-const MusicTrack* PlaylistModel::getTrack(int index) const noexcept {
+std::optional<MusicTrack> PlaylistModel::getTrack(int index) const noexcept {
+    /*
+     * 返回指定索引的音乐信息，从列存储中临时拼出
+     */
+    if (index >= 0 && index < m_tracks.size()) return m_tracks.track(index);
+    return std::nullopt;
+}
+
+int PlaylistModel::indexOf(const QString& filePath) const noexcept {
+    return m_tracks.find(filePath);
+}
+
+int PlaylistModel::indexOfId(quint32 id) const noexcept {
+    return m_tracks.find(id);
+}
+
+quint32 PlaylistModel::trackId(int index) const noexcept {
+    return index >= 0 && index < m_tracks.size() ? m_tracks.id(index) : std::numeric_limits<quint32>::max();
+}
+
+bool PlaylistModel::contains(const QString& filePath) const noexcept {
     /*
-     * 返回指定索引的音乐信息
+     * 按列表中保存的路径判断曲目是否还在列表中，保存的路径和规范化后的路径都认得；indexOf 只认保存的路径
      */
-    if (index >= 0 && index < m_tracks.size()) return &m_tracks.at(index);
-    return nullptr;
+    const auto it = m_pathKeys.constFind(filePath);
+    return m_pathIndex.contains(it == m_pathKeys.cend() ? filePath : *it);
+}
+
+QString PlaylistModel::coverPath(int index) const noexcept {
+    /*
+     * 返回指定索引内嵌封面在封面库中的文件路径，由调用方按需解码
+     */
+    if (index < 0 || index >= m_tracks.size()) return QString();
+    return m_covers.path(m_tracks.coverKey(index));
+}
+
+QImage PlaylistModel::thumbnail(int index) noexcept {
+    /*
+     * 返回指定索引的封面缩略图，由封面库的 LRU 缓存提供
+     */
+    if (index < 0 || index >= m_tracks.size()) return QImage();
+    return m_covers.thumbnail(m_tracks.coverKey(index));
 }
 
 int PlaylistModel::getTrackCount() const noexcept {
@@ -142,71 +443,560 @@ void PlaylistModel::removeTrack(int index) noexcept {
     /*
      * 从播放列表中移除指定索引的音乐
      */
-    if (index >= 0 && index < m_tracks.size()) {
-        beginRemoveRows(QModelIndex(), index, index);
-        m_tracks.removeAt(index);
-        endRemoveRows();
+    removeTracks({index});
+}
+
+void PlaylistModel::removeTracks(std::vector<int> rows) noexcept {
+    /*
+     * 批量删除。行号排序去重后，已交给视图的行合并成连续区间：
+     * 区间不多于 RemovalRanges 个时，尚未交给视图的行不用通知视图，一次压缩删掉，已交给视图的区间从后往前
+     * 逐个在 beginRemoveRows 和 endRemoveRows 之间删除，每次通知结束时曲目表都与视图看到的行数一致；
+     * 区间更多时每个区间都压缩一遍整张表太慢，改为在 layoutAboutToBeChanged 和 layoutChanged 之间一次压缩全部行，
+     * 被删行的持久索引改为无效，其余的按前面删掉的行数前移。
+     * 每一行都从后往前发出 trackRemoved，按行号或编号记录曲目的地方据此更新；整批只保存一次
+     */
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    rows.erase(rows.begin(), std::lower_bound(rows.begin(), rows.end(), 0));
+    rows.erase(std::lower_bound(rows.begin(), rows.end(), m_tracks.size()), rows.end());
+    if (rows.empty()) return;
+    std::vector<quint32> ids;
+    ids.reserve(rows.size());
+    QStringList paths;
+    paths.reserve(int(rows.size()));
+    for (const int row : rows) {
+        ids.push_back(m_tracks.id(row));
+        paths.append(m_tracks.path(row));
+        unindexPath(m_tracks.path(row));
+        unregisterTrack(row);
+    }
+    m_analyzer.remove(paths);
+    const size_t visible = size_t(std::lower_bound(rows.begin(), rows.end(), m_loaded) - rows.begin());
+    int ranges = 0;
+    for (size_t i = 0; i < visible; i++) ranges += i == 0 || rows[i - 1] != rows[i] - 1;
+    if (ranges > RemovalRanges) {
+        emit layoutAboutToBeChanged();
+        const QModelIndexList from = persistentIndexList();
+        m_tracks.remove(rows);
+        m_loaded -= int(visible);
+        QModelIndexList to;
+        to.reserve(from.size());
+        for (const QModelIndex& index : from) {
+            const auto it = std::lower_bound(rows.begin(), rows.end(), index.row());
+            const bool removed = it != rows.end() && *it == index.row();
+            to.append(removed ? QModelIndex() : this->index(index.row() - int(it - rows.begin()), index.column()));
+        }
+        changePersistentIndexList(from, to);
+        emit layoutChanged();
+        for (size_t i = rows.size(); i-- > 0;) emit trackRemoved(rows[i], ids[i]);
         emit playlistChanged();
+        return;
+    }
+    if (visible < rows.size()) {
+        m_tracks.remove(std::vector<int>(rows.begin() + visible, rows.end()));
+        for (size_t i = rows.size(); i-- > visible;) emit trackRemoved(rows[i], ids[i]);
+    }
+    for (size_t end = visible; end > 0;) {
+        size_t begin = end - 1;
+        while (begin > 0 && rows[begin - 1] == rows[begin] - 1) begin--;
+        beginRemoveRows(QModelIndex(), rows[begin], rows[end - 1]);
+        m_tracks.remove(std::vector<int>(rows.begin() + begin, rows.begin() + end));
+        m_loaded -= int(end - begin);
+        endRemoveRows();
+        for (size_t i = end; i-- > begin;) emit trackRemoved(rows[i], ids[i]);
+        end = begin;
     }
+    emit playlistChanged();
 }
 
 QString PlaylistModel::formatDuration(qint64 milliseconds) const noexcept {
     /*
-     * 将毫秒转换为分钟:秒格式的字符串
+     * 将毫秒转换为分钟:秒格式的字符串。不同的秒数只有几千种，生成过的文本缓存起来，绘制时不再重复格式化
      */
     if (milliseconds <= 0) return "未知时长";
-    qint64 seconds = milliseconds / 1000;
-    qint64 minutes = seconds / 60;
-    seconds = seconds % 60;
-    return tr("%1:%2").arg(minutes).arg(seconds, 2, 10, QChar('0'));
+    const qint64 total = milliseconds / 1000;
+    const auto it = m_durationTexts.constFind(total);
+    if (it != m_durationTexts.cend()) return *it;
+    const QString text = tr("%1:%2").arg(total / 60).arg(total % 60, 2, 10, QChar('0'));
+    m_durationTexts.insert(total, text);
+    return text;
+}
+
+QString PlaylistModel::dataDirectory() const noexcept {
+    /*
+     * 获取应用数据目录，播放列表和元数据缓存都保存在这里
+     */
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
 }
 
 QString PlaylistModel::defaultPath() noexcept {
     /*
-     * 获取默认的播放列表保存路径
+     * 旧版本保存播放列表的路径，只在第一次建立曲目库时导入
      */
-    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir{}.mkpath(dir);
-    return dir + "/playlist.txt";
+    return dataDirectory() + "/playlist.txt";
 }
 
 bool PlaylistModel::savePlayList() noexcept {
     /*
-     * 将当前播放列表保存到默认路径
+     * 把当前列表的顺序写回曲目库，连同其他列表一起保存。切换出去的列表在切换时已经写回，暂存期间不会变化
      */
-    QSaveFile file{defaultPath()};
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
-    QTextStream out{&file};
-    for (int i = 0; i < m_tracks.size(); i++) out << m_tracks[i].filePath << "\n";
-    return file.commit();
+    m_library.setTracks(m_library.current(), m_tracks.paths(), m_pathKeys);
+    if (!m_prober.isBusy()) m_cache.save(m_library.paths());
+    m_analysis.save(m_library.paths());
+    m_shuffle.save(m_tracks.ids());
+    return m_library.save();
 }
 
 bool PlaylistModel::loadPlayList() noexcept {
     /*
-     * 从默认路径加载播放列表
+     * 读取曲目库并打开上次的列表。曲目库还不存在时把旧版的 playlist.txt 导入为默认列表，两者都没有时建一个空列表
      */
-    QFile file{defaultPath()};
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    m_prober.cancel();
+    m_analyzer.clear();
+    m_cache.load();
+    m_analysis.load();
+    const bool loaded = m_library.load() || importPlayList();
+    if (!loaded) m_library.create("默认列表");
     beginResetModel();
+    m_sessions.clear();
+    m_sessions.resize(m_library.count());
     m_tracks.clear();
+    m_titleKeys.clear();
+    m_pathIndex.clear();
+    m_pathKeys.clear();
+    m_search.clear();
+    m_shuffle.clear();
+    m_filterMatches.clear();
+    openTracks(m_library.tracks(m_library.current()));
+    resetLoadedRows();
+    endResetModel();
+    m_shuffle.setDirectory(dataDirectory(), shuffleFileName(m_library.current()));
+    m_shuffle.load(m_tracks.ids());
+    updateWatchedDirectories();
+    m_watcher.setEnabled(QSettings().value("library/watch", false).toBool());
+    emit playlistChanged();
+    return loaded;
+}
+
+bool PlaylistModel::importPlayList() noexcept {
+    /*
+     * 旧版本的播放列表是每行一个路径的文本文件，按原顺序导入为一个列表。
+     * 只在第一次建立曲目库时执行一次，逐个解析规范路径，指向同一文件的路径只保留第一次出现
+     */
+    QFile file{defaultPath()};
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    std::vector<QString> paths;
+    QHash<QString, QString> keys;
+    QSet<QString> seen;
     QTextStream in{&file};
     while (!in.atEnd()) {
         const QString line = in.readLine();
         if (line.isEmpty()) continue;
-        m_tracks.append(MusicTrack(line));
+        const QString key = pathKey(line);
+        if (seen.contains(key)) continue;
+        seen.insert(key);
+        if (key != line) keys.insert(line, key);
+        paths.push_back(line);
+    }
+    m_library.setTracks(m_library.create("默认列表"), paths, keys);
+    return true;
+}
+
+int PlaylistModel::playlistCount() const noexcept {
+    return m_library.count();
+}
+
+QString PlaylistModel::playlistName(int index) const noexcept {
+    return index >= 0 && index < m_library.count() ? m_library.name(index) : QString();
+}
+
+int PlaylistModel::currentPlaylist() const noexcept {
+    return m_library.current();
+}
+
+void PlaylistModel::Session::swap(PlaylistModel& model) noexcept {
+    model.m_tracks.swap(tracks);
+    model.m_pathIndex.swap(pathIndex);
+    model.m_pathKeys.swap(pathKeys);
+    std::swap(model.m_shuffle, shuffle);
+}
+
+void PlaylistModel::openPlaylist(int index) noexcept {
+    /*
+     * 切换到另一个列表。当前列表写回曲目库后，曲目表、路径索引和随机队列整体交换出去暂存，切回来时再交换回来，
+     * 不重新读取元数据也不复制曲目。本次第一次打开的列表只按编号生成占位行，交给视图时才从元数据缓存中取出。
+     * 正在进行的导入和读取属于原来的列表，切换前停止；已经交给读取线程但还没有结果的行恢复为占位，切回来时重新取出。
+     * 随机队列在换出时写到该列表自己的文件里，本次第一次打开的列表从它的文件接着上次的一轮
+     */
+    const int current = m_library.current();
+    if (index < 0 || index >= m_library.count() || index == current) return;
+    const bool probing = m_prober.isBusy();
+    cancelImport();
+    m_analyzer.clear();
+    if (probing) {
+        for (int row = 0; row < m_tracks.size(); row++) if (m_tracks.fileSize(row) <= 0) m_tracks.setResolved(row, false);
     }
+    m_library.setTracks(current, m_tracks.paths(), m_pathKeys);
+    m_shuffle.save(m_tracks.ids());
+    const ShuffleQueue::Mode mode = m_shuffle.mode();
+    beginResetModel();
+    auto parked = std::make_unique<Session>(m_strings);
+    parked->swap(*this);
+    m_sessions[current] = std::move(parked);
+    const bool opened = m_sessions[index] != nullptr;
+    if (opened) {
+        m_sessions[index]->swap(*this);
+        m_sessions[index].reset();
+    } else openTracks(m_library.tracks(index));
+    m_shuffle.setDirectory(dataDirectory(), shuffleFileName(index));
+    if (!opened) m_shuffle.load(m_tracks.ids());
+    m_shuffle.setMode(mode);
+    resetLoadedRows();
     endResetModel();
+    for (int row = 0; row < m_tracks.size(); row++) if (m_tracks.resolved(row)) scheduleAnalysis(row);
+    m_library.setCurrent(index);
+    updateWatchedDirectories();
+    emit playlistChanged();
+}
+
+int PlaylistModel::createPlaylist(const QString& name) noexcept {
+    /*
+     * 新建一个空列表并切换过去
+     */
+    const int index = m_library.create(name);
+    m_sessions.resize(m_library.count());
+    openPlaylist(index);
+    return index;
+}
+
+void PlaylistModel::renamePlaylist(int index, const QString& name) noexcept {
+    m_library.rename(index, name);
+    emit playlistChanged();
+}
+
+bool PlaylistModel::removePlaylist(int index) noexcept {
+    /*
+     * 删除一个列表，至少保留一个。删除的是当前列表时先切换到相邻的列表；暂存的曲目从搜索索引中移除。
+     * 随机队列的文件按序号命名，删掉这个列表的文件，靠后的依次改名前移
+     */
+    if (index < 0 || index >= m_library.count() || m_library.count() <= 1) return false;
+    if (index == m_library.current()) openPlaylist(index > 0 ? index - 1 : index + 1);
+    if (const auto& session = m_sessions[index]) {
+        for (const quint32 id : session->tracks.ids()) {
+            if (id < m_titleKeys.size()) m_titleKeys[id].reset();
+            m_search.remove(id);
+        }
+    }
+    m_sessions.erase(m_sessions.begin() + index);
+    const int count = m_library.count();
+    m_library.remove(index);
+    QDir directory{dataDirectory()};
+    directory.remove(shuffleFileName(index));
+    for (int i = index + 1; i < count; i++) directory.rename(shuffleFileName(i), shuffleFileName(i - 1));
+    m_shuffle.setDirectory(dataDirectory(), shuffleFileName(m_library.current()));
     emit playlistChanged();
     return true;
 }
 
 void PlaylistModel::shuffle() noexcept {
     /*
-     * 随机打乱播放列表中的音乐顺序
+     * 重新打乱整个播放列表，从新的一轮开始随机播放
+     */
+    m_shuffle.reshuffle();
+}
+
+void PlaylistModel::setShuffleMode(ShuffleQueue::Mode mode) noexcept {
+    m_shuffle.setMode(mode);
+    QSettings().setValue("playback/shuffleMode", int(mode));
+}
+
+ShuffleQueue::Mode PlaylistModel::shuffleMode() const noexcept {
+    return m_shuffle.mode();
+}
+
+int PlaylistModel::shuffleNext() noexcept {
+    /*
+     * 随机播放的下一首，只查看不前进；本轮播完时会开始新的一轮
+     */
+    const quint32 id = m_shuffle.next();
+    return id == ShuffleQueue::None ? -1 : m_tracks.find(id);
+}
+
+int PlaylistModel::shufflePrevious() noexcept {
+    const quint32 id = m_shuffle.previous();
+    return id == ShuffleQueue::None ? -1 : m_tracks.find(id);
+}
+
+void PlaylistModel::shufflePlayed(int index) noexcept {
+    if (index >= 0 && index < m_tracks.size()) m_shuffle.played(m_tracks.id(index));
+}
+
+void PlaylistModel::sort(int column, Qt::SortOrder sortOrder) {
+    /*
+     * 按列重排整个播放列表。排序是稳定的，主键相同时依次比较固定的后续键：
+     * 艺术家 → 专辑 → 音轨号 → 标题；专辑 → 艺术家 → 音轨号 → 标题；标题 → 艺术家 → 专辑；时长 → 标题。
+     * 降序只作用于主键。比较时不调用 QCollator：艺术家和专辑比较驻留池的名次，标题比较按曲目缓存的排序键。
+     * 还是占位的行先从元数据缓存中取出，缓存中没有的按占位信息参与排序
+     */
+    if (column != Title && column != Artist && column != Album && column != Duration) return;
+    const int n = m_tracks.size();
+    if (n < 2) return;
+    materialize(0, n);
+    if (m_titleKeys.size() < m_nextId) m_titleKeys.resize(m_nextId);
+    std::vector<SortEntry> entries;
+    entries.reserve(n);
+    for (int row = 0; row < n; row++) {
+        std::optional<QCollatorSortKey>& title = m_titleKeys[m_tracks.id(row)];
+        if (!title) title = StringPool::sortKey(m_tracks.title(row));
+        entries.push_back(SortEntry{m_strings.rank(m_tracks.artistId(row)), m_strings.rank(m_tracks.albumId(row)),
+                                    m_tracks.trackNumber(row), qint32(m_tracks.duration(row)), &*title, row});
+    }
+    const int sign = sortOrder == Qt::AscendingOrder ? 1 : -1;
+    const auto compareKey = [](auto a, auto b) { return a < b ? -1 : (b < a ? 1 : 0); };
+    const auto less = [=](const SortEntry& a, const SortEntry& b) {
+        const auto title = [&] { return a.title->compare(*b.title); };
+        int c;
+        switch (column) {
+        case Artist:
+            c = sign * compareKey(a.artist, b.artist);
+            if (c == 0) c = compareKey(a.album, b.album);
+            if (c == 0) c = compareKey(a.number, b.number);
+            if (c == 0) c = title();
+            break;
+        case Album:
+            c = sign * compareKey(a.album, b.album);
+            if (c == 0) c = compareKey(a.artist, b.artist);
+            if (c == 0) c = compareKey(a.number, b.number);
+            if (c == 0) c = title();
+            break;
+        case Title:
+            c = sign * title();
+            if (c == 0) c = compareKey(a.artist, b.artist);
+            if (c == 0) c = compareKey(a.album, b.album);
+            break;
+        default:
+            c = sign * compareKey(a.duration, b.duration);
+            if (c == 0) c = title();
+        }
+        return c < 0;
+    };
+    parallelStableSort(entries, less);
+    std::vector<int> rows(n), newRows(n);
+    for (int i = 0; i < n; i++) {
+        rows[i] = entries[i].row;
+        newRows[entries[i].row] = i;
+    }
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    m_tracks.permute(rows);
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.size());
+    for (const QModelIndex& index : from) {
+        const int row = newRows[index.row()];
+        to.append(row < m_loaded ? this->index(row, index.column()) : QModelIndex());
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+    emit rowsRemapped(newRows);
+    emit playlistChanged();
+}
+
+QString PlaylistModel::pathKey(const QString& filePath) const noexcept {
+    /*
+     * 去重用的规范路径：解析符号链接和 ./..，在大小写不敏感的文件系统上再做大小写折叠
+     */
+    const QFileInfo info(filePath);
+    QString key = info.canonicalFilePath();
+    if (key.isEmpty()) key = info.absoluteFilePath();
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    key = key.toCaseFolded();
+#endif
+    if (key == filePath) return filePath;
+    return key;
+}
+
+void PlaylistModel::indexPath(const QString& filePath, const QString& key) noexcept {
+    m_pathIndex.insert(key);
+    if (key != filePath) m_pathKeys.insert(filePath, key);
+}
+
+void PlaylistModel::unindexPath(const QString& filePath) noexcept {
+    /*
+     * 只有规范路径与原路径不同时才单独记录，删除时据此找回当初的键
+     */
+    const auto it = m_pathKeys.constFind(filePath);
+    if (it == m_pathKeys.cend()) m_pathIndex.remove(filePath);
+    else {
+        m_pathIndex.remove(*it);
+        m_pathKeys.erase(it);
+    }
+}
+
+void PlaylistModel::registerTrack(MusicTrack& track) noexcept {
+    /*
+     * 给新曲目分配编号并加入搜索索引；正在过滤时单独判断这一首，不必重新搜索整个列表
+     */
+    track.id = m_nextId++;
+    const quint32 artist = m_strings.intern(track.artist);
+    m_search.insert(track.id, track.title, artist, m_strings.intern(track.album));
+    m_shuffle.insert(track.id, shuffleWeight(track.mtime), artist);
+    if (m_filterTerms.isEmpty()) return;
+    m_filterMatches.resize(m_nextId, false);
+    m_filterMatches[track.id] = m_search.matches(track.id, m_filterTerms);
+}
+
+void PlaylistModel::unregisterTrack(int row) noexcept {
+    const quint32 id = m_tracks.id(row);
+    if (id < m_titleKeys.size()) m_titleKeys[id].reset();
+    m_search.remove(id);
+    m_shuffle.remove(id);
+}
+
+void PlaylistModel::scheduleAnalysis(int row) noexcept {
+    /*
+     * 只分析已经读取过元数据的曲目，文件大小和修改时间用来判断已有的结果是否仍然有效
+     */
+    if (m_tracks.fileSize(row) > 0 && rowAnalysis(row) == nullptr) m_analyzer.enqueue(m_tracks.path(row));
+}
+
+const TrackAnalysis* PlaylistModel::rowAnalysis(int row) const noexcept {
+    return m_analysis.lookup(m_tracks.path(row), m_tracks.fileSize(row), m_tracks.mtime(row));
+}
+
+const TrackAnalysis* PlaylistModel::analysis(int index) const noexcept {
+    if (index < 0 || index >= m_tracks.size()) return nullptr;
+    return rowAnalysis(index);
+}
+
+void PlaylistModel::setPlaybackActive(bool active) noexcept {
+    m_analyzer.setPlaybackActive(active);
+}
+
+void PlaylistModel::trackAnalyzed(const QString& filePath, const TrackAnalysis& analysis) noexcept {
+    /*
+     * 保存分析结果并刷新这一行。每积累一批结果写一次盘，中途退出也只需要重新分析少量曲目
+     */
+    const int row = m_tracks.find(filePath);
+    if (row < 0) return;
+    m_analysis.store(filePath, m_tracks.fileSize(row), m_tracks.mtime(row), analysis);
+    if (++m_unsavedAnalyses >= 32 || m_analyzer.isIdle()) {
+        m_analysis.save(m_library.paths());
+        m_unsavedAnalyses = 0;
+    }
+    rowsChanged(row, Loudness, Bpm);
+}
+
+void PlaylistModel::rowsChanged(int row, int firstColumn, int lastColumn) noexcept {
+    /*
+     * 尚未交给视图的行不发通知
+     */
+    if (row < m_loaded) emit dataChanged(index(row, firstColumn), index(row, lastColumn));
+}
+
+void PlaylistModel::setFilter(const QString& query) noexcept {
+    /*
+     * 按输入的关键词更新过滤结果，视图通过 PlaylistFilterProxy 读取
+     */
+    m_filterTerms = SearchIndex::terms(query);
+    if (!m_filterTerms.isEmpty()) materialize(0, m_tracks.size());
+    if (m_filterTerms.isEmpty()) m_filterMatches.clear();
+    else m_filterMatches = m_search.search(m_filterTerms);
+    m_filterMatches.resize(m_nextId, false);
+    /*
+     * 过滤作用于整个列表，所以要把尚未加载的行全部取出并交给视图
+     */
+    if (!m_filterTerms.isEmpty()) exposeRows(m_tracks.size());
+}
+
+bool PlaylistModel::isFiltering() const noexcept {
+    return !m_filterTerms.isEmpty();
+}
+
+bool PlaylistModel::filterAccepts(int row) const noexcept {
+    if (m_filterTerms.isEmpty()) return true;
+    if (row < 0 || row >= m_tracks.size()) return false;
+    return m_filterMatches[m_tracks.id(row)];
+}
+
+void PlaylistModel::cancelImport() noexcept {
+    /*
+     * 停止文件夹扫描和后台元数据读取，已加入但尚未读取的曲目保留占位信息
+     */
+    m_scanner.cancel();
+    m_prober.cancel();
+}
+
+bool PlaylistModel::isScanning() const noexcept {
+    return m_scanner.isBusy();
+}
+
+void PlaylistModel::removeFiles(const QStringList& filePaths) noexcept {
+    /*
+     * 按路径移除曲目，找出所在的行后整批删除
+     */
+    std::vector<int> rows;
+    for (const QString& path : filePaths) {
+        const int row = m_tracks.find(path);
+        if (row >= 0) rows.push_back(row);
+    }
+    removeTracks(std::move(rows));
+}
+
+void PlaylistModel::setWatching(bool watching) noexcept {
+    /*
+     * 开关文件夹监视，设置会被保存
+     */
+    QSettings().setValue("library/watch", watching);
+    if (watching) updateWatchedDirectories();
+    m_watcher.setEnabled(watching);
+}
+
+bool PlaylistModel::isWatching() const noexcept {
+    return m_watcher.isEnabled();
+}
+
+void PlaylistModel::updateWatchedDirectories() noexcept {
+    /*
+     * 收集所有曲目所在的目录交给监视器，随播放列表的延迟保存一起执行
+     */
+    QSet<QString> directories;
+    for (const QString& path : m_tracks.paths()) directories.insert(path.left(path.lastIndexOf('/')));
+    m_watcher.setDirectories(directories);
+}
+
+void PlaylistModel::applyLibraryChanges(const LibraryWatcher::Delta& delta) noexcept {
+    /*
+     * 只应用差异：删除消失的文件，加入新文件，重新读取被修改文件的元数据，新目录交给扫描器
+     */
+    if (!delta.removed.isEmpty()) removeFiles(delta.removed);
+    if (!delta.added.isEmpty()) addMusicFiles(delta.added);
+    if (!delta.changed.isEmpty()) m_prober.enqueue(delta.changed);
+    for (const QString& directory : delta.directories) m_scanner.scan(directory);
+}
+
+void PlaylistModel::trackProbed(const MusicTrack& track) noexcept {
+    /*
+     * 后台读取完成后写入元数据缓存，曲目还在当前列表中时回填元数据并通知视图刷新这一行，读取期间已被删除的只进缓存。
+     * 切换列表时 cancelImport 作废了尚未返回的读取，这些结果不会到达这里；对应的行已恢复为占位，切回来时重新读取
+     */
+    m_cache.store(track);
+    const int row = m_tracks.find(track.filePath);
+    if (row < 0) return;
+    MusicTrack updated = track;
+    updated.id = m_tracks.id(row);
+    updateTrack(row, updated);
+    rowsChanged(row, Title, Bpm);
+}
+
+void PlaylistModel::updateTrack(int row, const MusicTrack& track) noexcept {
+    /*
+     * 用读取到的元数据替换一行，同步排序键、搜索索引、随机队列和过滤结果，再按需安排分析
      */
-    order = std::vector<int>(m_tracks.size());
-    std::iota(order.begin(), order.end(), 0);
-    std::random_device rd;
-    std::mt19937 rng(rd());
-    std::shuffle(order.begin(), order.end(), rng);
+    const quint32 id = track.id;
+    if (id < m_titleKeys.size()) m_titleKeys[id].reset();
+    m_tracks.set(row, track);
+    m_search.insert(id, track.title, m_tracks.artistId(row), m_tracks.albumId(row));
+    m_shuffle.update(id, shuffleWeight(track.mtime), m_tracks.artistId(row));
+    if (!m_filterTerms.isEmpty()) m_filterMatches[id] = m_search.matches(id, m_filterTerms);
+    scheduleAnalysis(row);
 }
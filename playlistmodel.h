@@ -1,92 +1,195 @@
 #ifndef PLAYLISTMODEL_H
 #define PLAYLISTMODEL_H
 
+#include <memory>
+#include <optional>
 #include <vector>
 
 #include <QAbstractTableModel>
+#include <QIcon>
 #include <QStringList>
+#include <QSet>
+#include <QHash>
+#include <QTimer>
 #include <QFileInfo>
 #include <QDir>
-#include <QUrl>
-#include <QMediaPlayer>
-#include <QEventLoop>
-#include <QMediaMetaData>
-#include <QImage>
 #include <QStyledItemDelegate>
-
-struct MusicTrack {
-    QString filePath, title, artist, album;
-    qint64 duration;
-    QImage cover;
-
-    MusicTrack(const QString& path) noexcept : filePath(path) {
-        QMediaPlayer probe;
-        probe.setSource(QUrl::fromLocalFile(path));
-        QEventLoop loop;
-        QObject::connect(&probe, &QMediaPlayer::metaDataChanged,&loop, &QEventLoop::quit);
-        loop.exec();
-        duration = probe.duration();
-        cover = probe.metaData().value(QMediaMetaData::CoverArtImage).value<QImage>();
-        if (cover.isNull()) cover = probe.metaData().value(QMediaMetaData::ThumbnailImage).value<QImage>();
-        title = probe.metaData().stringValue(QMediaMetaData::Title);
-        if (title.isEmpty()) title = QFileInfo(path).baseName();
-        artist = probe.metaData().stringValue(QMediaMetaData::Author);
-        if (artist.isEmpty()){
-            artist = probe.metaData().stringValue(QMediaMetaData::AlbumArtist);
-            if(artist.isEmpty()){
-                artist = probe.metaData().stringValue(QMediaMetaData::ContributingArtist);
-                if(artist.isEmpty()) artist = "未知艺术家";
-            }
-        }
-        album = probe.metaData().stringValue(QMediaMetaData::AlbumTitle);
-        if (album.isEmpty()) album = "未知专辑";
-    }
-};
+#include <QSortFilterProxyModel>
+
+#include "musictrack.h"
+#include "stringpool.h"
+#include "tracktable.h"
+#include "tracklibrary.h"
+#include "metadataprober.h"
+#include "metadatacache.h"
+#include "coverstore.h"
+#include "folderscanner.h"
+#include "librarywatcher.h"
+#include "searchindex.h"
+#include "analysisstore.h"
+#include "analysisscheduler.h"
+#include "shufflequeue.h"
 
 class PlaylistModel : public QAbstractTableModel {
     Q_OBJECT
 
 public:
     enum Column {
-        Delete = 0, Title, Artist, Album, Duration,
+        Delete = 0, Title, Artist, Album, Duration, Loudness, Bpm,
         ColumnCount
     };
 
+    static constexpr int FetchBatch = 4096;  // 视图每次向模型多要的行数
+    static constexpr int RemovalRanges = 4;  // 批量删除时逐个区间通知视图的区间数上限，超过时整体压缩后发出 layoutChanged
+
     enum PlayMode : uint8_t {
         Ordered, Looped, Shuffled
     } playMode{PlayMode::Ordered};
 
     explicit PlaylistModel(QWidget* parent = nullptr) noexcept;
+    ~PlaylistModel();
 
     int rowCount(const QModelIndex& parent = QModelIndex()) const override;
     int columnCount(const QModelIndex& parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    void sort(int column, Qt::SortOrder sortOrder = Qt::AscendingOrder) override;
 
     void addMusicFile(const QString& filePath) noexcept;
     void addMusicFolder(const QString& folderPath) noexcept;
     void clearPlaylist() noexcept;
-    const MusicTrack* getTrack(int index) const noexcept;
+    std::optional<MusicTrack> getTrack(int index) const noexcept;
+    int indexOf(const QString& filePath) const noexcept;
+    bool contains(const QString& filePath) const noexcept;
+    int indexOfId(quint32 id) const noexcept;
+    quint32 trackId(int index) const noexcept;
+    void fetchUpTo(int index) noexcept;
+    QString coverPath(int index) const noexcept;
+    QImage thumbnail(int index) noexcept;
     int getTrackCount() const noexcept;
     void removeTrack(int index) noexcept;
+    void removeTracks(std::vector<int> rows) noexcept;
     void shuffle() noexcept;
-
-    std::vector<int> order;
+    void setShuffleMode(ShuffleQueue::Mode mode) noexcept;
+    ShuffleQueue::Mode shuffleMode() const noexcept;
+    int shuffleNext() noexcept;
+    int shufflePrevious() noexcept;
+    void shufflePlayed(int index) noexcept;
+    void cancelImport() noexcept;
+    bool isScanning() const noexcept;
+    void removeFiles(const QStringList& filePaths) noexcept;
+    void setWatching(bool watching) noexcept;
+    bool isWatching() const noexcept;
+    void setFilter(const QString& query) noexcept;
+    bool isFiltering() const noexcept;
+    bool filterAccepts(int row) const noexcept;
+    const TrackAnalysis* analysis(int index) const noexcept;
+    void setPlaybackActive(bool active) noexcept;
+    int playlistCount() const noexcept;
+    QString playlistName(int index) const noexcept;
+    int currentPlaylist() const noexcept;
+    void openPlaylist(int index) noexcept;
+    int createPlaylist(const QString& name) noexcept;
+    void renamePlaylist(int index, const QString& name) noexcept;
+    bool removePlaylist(int index) noexcept;
 
 public slots:
+    int addMusicFiles(const QStringList& filePaths) noexcept;
     bool savePlayList() noexcept;
     bool loadPlayList() noexcept;
 
 signals:
     void playlistChanged();
+    void rowsRemapped(const std::vector<int>& rows);  // rows[原行号] 是新行号
+    void trackRemoved(int row, quint32 id);  // row 是删除前的行号
+    void probeProgress(int done, int total);
+    void scanProgress(int directories, int files);
+    void scanFinished();
+
+private slots:
+    void trackProbed(const MusicTrack& track) noexcept;
+    void applyLibraryChanges(const LibraryWatcher::Delta& delta) noexcept;
+    void updateWatchedDirectories() noexcept;
+    void trackAnalyzed(const QString& filePath, const TrackAnalysis& analysis) noexcept;
 
 private:
+    /*
+     * 切换出去的列表：曲目表、路径索引和随机队列原样暂存，切回来时整体交换，不重新读取也不复制曲目
+     */
+    struct Session {
+        explicit Session(StringPool& strings) noexcept : tracks(strings) {}
+        void swap(PlaylistModel& model) noexcept;
+        TrackTable tracks;
+        QSet<QString> pathIndex;
+        QHash<QString, QString> pathKeys;
+        ShuffleQueue shuffle;
+    };
+
+    QString pathKey(const QString& filePath) const noexcept;
+    void indexPath(const QString& filePath, const QString& key) noexcept;
+    void unindexPath(const QString& filePath) noexcept;
+    void registerTrack(MusicTrack& track) noexcept;
+    void unregisterTrack(int row) noexcept;
+    void scheduleAnalysis(int row) noexcept;
+    const TrackAnalysis* rowAnalysis(int row) const noexcept;
+    void appendTracks(const QStringList& paths) noexcept;
+    void exposeRows(int count) noexcept;
+    void resetLoadedRows() noexcept;
+    void openTracks(const std::vector<quint32>& ids) noexcept;
+    void materialize(int first, int last) noexcept;
+    bool resolveRow(int row) noexcept;
+    void updateTrack(int row, const MusicTrack& track) noexcept;
+    bool importPlayList() noexcept;
+    void rowsChanged(int row, int firstColumn, int lastColumn) noexcept;
+    QString dataDirectory() const noexcept;
     QString defaultPath() noexcept;
     QString formatDuration(qint64 milliseconds) const noexcept;
 
     QWidget* parent;
-    QList<MusicTrack> m_tracks;
+    StringPool m_strings;  // 艺术家、专辑和封面引用的驻留池，曲目表、元数据缓存和搜索索引共用
+    TrackTable m_tracks{m_strings};
+    int m_loaded{0};  // 已经交给视图的行数，其余行等视图滚动到底部时由 fetchMore 逐批加入
+    QIcon m_deleteIcon;
+    mutable QHash<qint64, QString> m_durationTexts;  // 按秒数缓存的时长文本
+    std::vector<std::optional<QCollatorSortKey>> m_titleKeys;  // 按曲目编号缓存的标题排序键，首次排序时生成，标题变化后作废
     QStringList m_supportedFormats;
+    QSet<QString> m_pathIndex;
+    QHash<QString, QString> m_pathKeys;
+    MetadataProber m_prober;
+    FolderScanner m_scanner;
+    LibraryWatcher m_watcher;
+    QStringList m_roots;
+    MetadataCache m_cache{m_strings};
+    CoverStore m_covers;
+    QTimer m_saveTimer;
+    SearchIndex m_search{m_strings};
+    QStringList m_filterTerms;
+    std::vector<bool> m_filterMatches;
+    quint32 m_nextId{0};
+    AnalysisStore m_analysis;
+    AnalysisScheduler m_analyzer;
+    int m_unsavedAnalyses{0};
+    ShuffleQueue m_shuffle;
+    TrackLibrary m_library;
+    std::vector<std::unique_ptr<Session>> m_sessions;  // 按列表序号暂存，当前列表和本次还没有打开过的列表为空
+};
+
+
+class PlaylistFilterProxy : public QSortFilterProxyModel {
+    Q_OBJECT
+public:
+    using QSortFilterProxyModel::QSortFilterProxyModel;
+    void setFilter(PlaylistModel* model, const QString& query) {
+        model->setFilter(query);
+        invalidateFilter();
+    }
+protected:
+    bool filterAcceptsRow(int row, const QModelIndex& parent) const override {
+        Q_UNUSED(parent)
+        return static_cast<const PlaylistModel*>(sourceModel())->filterAccepts(row);
+    }
 };
 
 
@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "playqueue.h"
+#include "playlistmodel.h"
+
+PlayQueue::PlayQueue(PlaylistModel& playlist, QObject* parent) noexcept : QAbstractListModel(parent), m_playlist(playlist) {
+    /*
+     * 曲目从列表中删除时移出队列；列表被清空或重新加载时编号全部作废，队列随之清空。
+     * 列表中的行更新时只刷新其中排在队列里的几项，不在队列中的行按编号一步判断
+     */
+    connect(&playlist, &PlaylistModel::trackRemoved, this, [this](int, quint32 id) { remove(id); });
+    connect(&playlist, &QAbstractItemModel::modelReset, this, &PlayQueue::clear);
+    connect(&playlist, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        if (m_size == 0) return;
+        int first = m_size, last = -1;
+        for (int row = topLeft.row(); row <= bottomRight.row(); row++) {
+            const quint32 id = m_playlist.trackId(row);
+            if (!contains(id)) continue;
+            const int at = rowOf(id);
+            first = std::min(first, at);
+            last = std::max(last, at);
+        }
+        if (last >= 0) emit dataChanged(index(first), index(last));
+    });
+}
+
+int PlayQueue::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : m_size;
+}
+
+QVariant PlayQueue::data(const QModelIndex& index, int role) const {
+    /*
+     * 显示“艺术家 - 标题”，提示中显示文件路径
+     */
+    if (!index.isValid() || (role != Qt::DisplayRole && role != Qt::ToolTipRole)) return QVariant();
+    const auto track = m_playlist.getTrack(m_playlist.indexOfId(idAt(index.row())));
+    if (!track) return QVariant();
+    return role == Qt::DisplayRole ? track->artist + " - " + track->title : track->filePath;
+}
+
+Qt::ItemFlags PlayQueue::flags(const QModelIndex& index) const {
+    /*
+     * 只能拖到两项之间，不能拖到某一项上
+     */
+    if (!index.isValid()) return Qt::ItemIsDropEnabled;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsDragEnabled | Qt::ItemNeverHasChildren;
+}
+
+Qt::DropActions PlayQueue::supportedDropActions() const {
+    return Qt::MoveAction;
+}
+
+bool PlayQueue::moveRows(const QModelIndex& sourceParent, int sourceRow, int count, const QModelIndex& destinationParent, int destinationChild) {
+    /*
+     * 视图内拖动排序时调用，把连续的几项整体移到 destinationChild 之前
+     */
+    if (sourceParent.isValid() || destinationParent.isValid() || count <= 0 || sourceRow < 0 || sourceRow + count > m_size) return false;
+    if (destinationChild < 0 || destinationChild > m_size || (destinationChild >= sourceRow && destinationChild <= sourceRow + count)) return false;
+    std::vector<quint32> ids{idAt(sourceRow)};
+    while (int(ids.size()) < count) ids.push_back(m_next[ids.back()]);
+    const quint32 before = idAt(destinationChild);
+    beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1, QModelIndex(), destinationChild);
+    for (const quint32 id : ids) {
+        unlink(id);
+        link(id, before);
+    }
+    endMoveRows();
+    return true;
+}
+
+void PlayQueue::enqueue(quint32 id) noexcept {
+    /*
+     * 加到队尾，已经在队列中时移到队尾
+     */
+    place(id, None);
+}
+
+void PlayQueue::playNext(quint32 id) noexcept {
+    /*
+     * 插到队首，作为下一首播放
+     */
+    place(id, m_head);
+}
+
+void PlayQueue::remove(quint32 id) noexcept {
+    if (!contains(id)) return;
+    const int row = rowOf(id);
+    beginRemoveRows(QModelIndex(), row, row);
+    unlink(id);
+    endRemoveRows();
+}
+
+void PlayQueue::clear() noexcept {
+    beginResetModel();
+    m_prev.clear();
+    m_next.clear();
+    m_queued.clear();
+    m_head = m_tail = None;
+    m_size = 0;
+    m_cachedRow = -1;
+    endResetModel();
+}
+
+quint32 PlayQueue::idAt(int row) const noexcept {
+    /*
+     * 按行号找到曲目编号。视图从上往下取数据，从上次的位置接着向后走，整屏只需走一遍
+     */
+    if (row < 0 || row >= m_size) return None;
+    int at = 0;
+    quint32 id = m_head;
+    if (m_cachedRow >= 0 && m_cachedRow <= row) {
+        at = m_cachedRow;
+        id = m_cachedId;
+    }
+    for (; at < row; at++) id = m_next[id];
+    m_cachedRow = row;
+    m_cachedId = id;
+    return id;
+}
+
+void PlayQueue::place(quint32 id, quint32 before) noexcept {
+    /*
+     * 放到 before 之前，before 为 None 时放到队尾；已经在队列中时整体移动过去
+     */
+    if (id == None || id == before) return;
+    const int target = before == None ? m_size : rowOf(before);
+    if (contains(id)) {
+        const int row = rowOf(id);
+        if (row == target || row + 1 == target) return;
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), target);
+        unlink(id);
+        link(id, before);
+        endMoveRows();
+        return;
+    }
+    beginInsertRows(QModelIndex(), target, target);
+    link(id, before);
+    endInsertRows();
+}
+
+void PlayQueue::link(quint32 id, quint32 before) noexcept {
+    if (id >= m_queued.size()) {
+        m_prev.resize(size_t(id) + 1, None);
+        m_next.resize(size_t(id) + 1, None);
+        m_queued.resize(size_t(id) + 1, false);
+    }
+    m_prev[id] = before == None ? m_tail : m_prev[before];
+    m_next[id] = before;
+    (m_prev[id] != None ? m_next[m_prev[id]] : m_head) = id;
+    (before != None ? m_prev[before] : m_tail) = id;
+    m_queued[id] = true;
+    m_size++;
+    m_cachedRow = -1;
+}
+
+void PlayQueue::unlink(quint32 id) noexcept {
+    (m_prev[id] != None ? m_next[m_prev[id]] : m_head) = m_next[id];
+    (m_next[id] != None ? m_prev[m_next[id]] : m_tail) = m_prev[id];
+    m_queued[id] = false;
+    m_size--;
+    m_cachedRow = -1;
+}
+
+int PlayQueue::rowOf(quint32 id) const noexcept {
+    /*
+     * 只有通知视图时才需要行号，从队首数过去；队列通常很短，移出队首时不用走
+     */
+    int row = 0;
+    for (quint32 at = m_head; at != id && at != None; at = m_next[at]) row++;
+    return row;
+}
@@ -0,0 +1,54 @@
+#ifndef PLAYQUEUE_H
+#define PLAYQUEUE_H
+
+#include <limits>
+#include <vector>
+
+#include <QAbstractListModel>
+
+class PlaylistModel;
+
+/*
+ * 用户指定的播放队列，优先于播放模式决定下一首。按曲目编号组成双向链表，编号在本次运行中不变，
+ * 列表排序或删除其他行都不影响队列。入队、插到队首、移出和调整位置在链表上只改动相邻的节点，按编号判断是否在队列中是 O(1)；
+ * 但通知视图要用的行号没有单独维护，rowOf 和 idAt 需要从队首（或上次的位置）数过去，是 O(n)。队列是手动排的，通常只有几十项
+ */
+class PlayQueue : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    static constexpr quint32 None = std::numeric_limits<quint32>::max();
+
+    explicit PlayQueue(PlaylistModel& playlist, QObject* parent = nullptr) noexcept;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    Qt::DropActions supportedDropActions() const override;
+    bool moveRows(const QModelIndex& sourceParent, int sourceRow, int count, const QModelIndex& destinationParent, int destinationChild) override;
+
+    void enqueue(quint32 id) noexcept;
+    void playNext(quint32 id) noexcept;
+    void remove(quint32 id) noexcept;
+    void clear() noexcept;
+    quint32 front() const noexcept { return m_head; }
+    quint32 idAt(int row) const noexcept;
+    bool contains(quint32 id) const noexcept { return id < m_queued.size() && m_queued[id]; }
+    bool isEmpty() const noexcept { return m_size == 0; }
+
+private:
+    void place(quint32 id, quint32 before) noexcept;
+    void link(quint32 id, quint32 before) noexcept;
+    void unlink(quint32 id) noexcept;
+    int rowOf(quint32 id) const noexcept;
+
+    PlaylistModel& m_playlist;
+    std::vector<quint32> m_prev, m_next;  // 按编号记录的前后节点
+    std::vector<bool> m_queued;
+    quint32 m_head{None}, m_tail{None};
+    int m_size{0};
+    mutable int m_cachedRow{-1};          // 上次按行号找到的节点，视图逐行取数据时从这里接着走
+    mutable quint32 m_cachedId{None};
+};
+
+#endif // PLAYQUEUE_H
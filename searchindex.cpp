@@ -0,0 +1,183 @@
+#include <algorithm>
+
+#include <QCollator>
+#include <QLocale>
+
+#include "searchindex.h"
+
+namespace {
+
+/*
+ * 拼音排序下每个声母的第一个汉字，汉字落在哪两个边界之间就取哪个首字母
+ */
+constexpr char16_t PinyinBoundaries[] = u"阿八嚓哒妸发旮哈讥咔垃痳拏噢妑七呥仨他屲夕丫帀";
+constexpr char PinyinLetters[] = "abcdefghjklmnopqrstwxyz";
+
+char pinyinInitial(QChar c) noexcept {
+    /*
+     * 用中文排序规则二分查找汉字的拼音首字母，结果按码位缓存。索引只在主线程使用，缓存不加锁
+     */
+    static QCollator collator(QLocale(QLocale::Chinese, QLocale::China));
+    static QHash<char16_t, char> cache;
+    const auto it = cache.constFind(c.unicode());
+    if (it != cache.cend()) return *it;
+    const QStringView text(&c, 1);
+    int lo = 0, hi = int(std::size(PinyinLetters)) - 1;
+    char letter = 0;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (collator.compare(QStringView(&PinyinBoundaries[mid], 1), text) <= 0) {
+            letter = PinyinLetters[mid];
+            lo = mid + 1;
+        }
+        else hi = mid;
+    }
+    cache.insert(c.unicode(), letter);
+    return letter;
+}
+
+}
+
+void SearchIndex::insert(quint32 id, const QString& title, quint32 artist, quint32 album) noexcept {
+    /*
+     * 加入或更新一首曲目。标题的检索文本每首单独保存，艺术家和专辑只记驻留编号，检索文本按编号共用。
+     * 更新时旧的倒排项不立即删除，查询时逐条校验，过期项多于有效项时整体重建
+     */
+    if (id >= m_entries.size()) m_entries.resize(id + 1);
+    Entry& entry = m_entries[id];
+    if (!entry.live) m_live++;
+    else m_stale++;
+    entry.live = true;
+    entry.title = searchText(title);
+    entry.artist = artist;
+    entry.album = album;
+    fieldText(artist);
+    fieldText(album);
+    if (m_stale > m_live && m_stale > 1024) rebuild();
+    else addPostings(id);
+}
+
+void SearchIndex::remove(quint32 id) noexcept {
+    if (id >= m_entries.size() || !m_entries[id].live) return;
+    m_entries[id] = Entry();
+    m_live--;
+    m_stale++;
+    if (m_stale > m_live && m_stale > 1024) rebuild();
+}
+
+void SearchIndex::clear() noexcept {
+    m_postings.clear();
+    m_entries.clear();
+    m_live = m_stale = 0;
+}
+
+std::vector<bool> SearchIndex::search(const QStringList& terms) const noexcept {
+    /*
+     * 每个关键词拆成单字或相邻两字的 n-gram，取所有关键词中最短的倒排表作为候选，再逐条确认包含全部关键词。
+     * 前缀和子串匹配都由同一套 n-gram 覆盖，结果按曲目编号标记
+     */
+    std::vector<bool> result(m_entries.size(), false);
+    const std::vector<quint32>* candidates = nullptr;
+    for (const QString& term : terms) {
+        const int grams = term.size() == 1 ? 1 : term.size() - 1;
+        for (int i = 0; i < grams; i++) {
+            const auto it = m_postings.constFind(term.size() == 1 ? gram(term[0], QChar(0)) : gram(term[i], term[i + 1]));
+            if (it == m_postings.cend()) return result;
+            if (candidates == nullptr || it->size() < candidates->size()) candidates = &*it;
+        }
+    }
+    if (candidates == nullptr) return result;
+    for (const quint32 id : *candidates) {
+        if (!result[id] && matches(id, terms)) result[id] = true;
+    }
+    return result;
+}
+
+bool SearchIndex::matches(quint32 id, const QStringList& terms) const noexcept {
+    /*
+     * 关键词不含换行，分字段查找与在三个字段连接起来的文本中查找结果相同
+     */
+    if (id >= m_entries.size() || !m_entries[id].live) return false;
+    const Entry& entry = m_entries[id];
+    const QString& artist = m_fields[entry.artist];
+    const QString& album = m_fields[entry.album];
+    return std::all_of(terms.cbegin(), terms.cend(), [&](const QString& term) {
+        return entry.title.contains(term) || artist.contains(term) || album.contains(term);
+    });
+}
+
+QStringList SearchIndex::terms(const QString& query) noexcept {
+    /*
+     * 把输入拆成折叠过大小写的关键词，空格分隔的多个关键词需要同时命中
+     */
+    return query.toCaseFolded().simplified().split(' ', Qt::SkipEmptyParts);
+}
+
+QString SearchIndex::searchText(const QString& field) noexcept {
+    /*
+     * 字段折叠大小写，含汉字时再用换行附上拼音首字母
+     */
+    QString text = field.toCaseFolded();
+    const QString initials = pinyinInitials(field);
+    if (!initials.isEmpty()) text += '\n' + initials;
+    return text;
+}
+
+const QString& SearchIndex::fieldText(quint32 string) noexcept {
+    if (string >= m_fields.size()) m_fields.resize(m_strings.size());
+    QString& text = m_fields[string];
+    if (text.isNull()) text = searchText(m_strings.at(string));
+    return text;
+}
+
+QString SearchIndex::pinyinInitials(const QString& text) noexcept {
+    /*
+     * 汉字换成拼音首字母，字母和数字原样保留，其余字符丢弃；不含汉字时返回空串
+     */
+    QString initials;
+    bool chinese = false;
+    for (const QChar c : text) {
+        if (c.unicode() >= 0x4E00 && c.unicode() <= 0x9FFF) {
+            const char letter = pinyinInitial(c);
+            if (letter == 0) continue;
+            initials += QLatin1Char(letter);
+            chinese = true;
+        }
+        else if (c.isLetterOrNumber()) initials += c.toCaseFolded();
+    }
+    return chinese ? initials : QString();
+}
+
+void SearchIndex::collectGrams(const QString& text, std::vector<quint32>& grams) noexcept {
+    /*
+     * 收集出现过的单字和相邻两字，跨换行的组合不会被查询用到，直接跳过
+     */
+    for (int i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') continue;
+        grams.push_back(gram(text[i], QChar(0)));
+        if (i + 1 < text.size() && text[i + 1] != '\n') grams.push_back(gram(text[i], text[i + 1]));
+    }
+}
+
+void SearchIndex::addPostings(quint32 id) noexcept {
+    /*
+     * 登记一首曲目三个字段中出现过的 n-gram，同一个只登记一次
+     */
+    const Entry& entry = m_entries[id];
+    const QString& artist = m_fields[entry.artist];
+    const QString& album = m_fields[entry.album];
+    std::vector<quint32> grams;
+    grams.reserve((entry.title.size() + artist.size() + album.size()) * 2);
+    collectGrams(entry.title, grams);
+    collectGrams(artist, grams);
+    collectGrams(album, grams);
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (const quint32 g : grams) m_postings[g].push_back(id);
+}
+
+void SearchIndex::rebuild() noexcept {
+    m_postings.clear();
+    m_stale = 0;
+    for (quint32 id = 0; id < m_entries.size(); id++) if (m_entries[id].live) addPostings(id);
+}
@@ -0,0 +1,46 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+#include "stringpool.h"
+
+class SearchIndex {
+public:
+    explicit SearchIndex(const StringPool& strings) noexcept : m_strings(strings) {}
+
+    void insert(quint32 id, const QString& title, quint32 artist, quint32 album) noexcept;
+    void remove(quint32 id) noexcept;
+    void clear() noexcept;
+    std::vector<bool> search(const QStringList& terms) const noexcept;
+    bool matches(quint32 id, const QStringList& terms) const noexcept;
+
+    static QStringList terms(const QString& query) noexcept;
+
+private:
+    struct Entry {
+        QString title;
+        quint32 artist{0}, album{0};
+        bool live{false};  // 编号未使用或已删除时为 false
+    };
+
+    static QString searchText(const QString& field) noexcept;
+    static QString pinyinInitials(const QString& text) noexcept;
+    static quint32 gram(QChar a, QChar b) noexcept { return (quint32(a.unicode()) << 16) | b.unicode(); }
+    static void collectGrams(const QString& text, std::vector<quint32>& grams) noexcept;
+    const QString& fieldText(quint32 string) noexcept;
+    void addPostings(quint32 id) noexcept;
+    void rebuild() noexcept;
+
+    const StringPool& m_strings;
+    QHash<quint32, std::vector<quint32>> m_postings;
+    std::vector<Entry> m_entries;
+    std::vector<QString> m_fields;  // 按驻留编号缓存艺术家和专辑的检索文本，同名的只生成一份
+    qsizetype m_live{0}, m_stale{0};
+};
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <cmath>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+
+#include "shufflequeue.h"
+
+ShuffleQueue::ShuffleQueue() noexcept : m_rng(std::random_device{}()) {}
+
+void ShuffleQueue::setDirectory(const QString& directory, const QString& fileName) noexcept {
+    /*
+     * 每个播放列表的队列各自保存在一个文件中
+     */
+    m_directory = directory;
+    m_fileName = fileName;
+}
+
+bool ShuffleQueue::load(const std::vector<quint32>& ids) noexcept {
+    /*
+     * 在所有曲目都插入之后调用。文件中按行号记录上次的顺序，ids 是当前各行的编号；
+     * 文件中没有的曲目随机放到游标之后，文件缺失或损坏时保留现有的随机顺序
+     */
+    QFile file{m_directory + "/" + m_fileName};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, count;
+    qint32 cursor, last;
+    in >> magic >> version >> cursor >> last >> count;
+    if (in.status() != QDataStream::Ok || magic != Magic || version != Version) return false;
+    std::vector<quint32> restored;
+    restored.reserve(std::min<size_t>(count, ids.size()));
+    std::vector<bool> taken(m_slots.size(), false);
+    for (quint32 i = 0; i < count; i++) {
+        qint32 row;
+        in >> row;
+        if (in.status() != QDataStream::Ok) return false;
+        if (row < 0 || size_t(row) >= ids.size() || !contains(ids[row]) || taken[ids[row]]) continue;
+        restored.push_back(ids[row]);
+        taken[ids[row]] = true;
+    }
+    std::vector<quint32> rest;
+    for (const quint32 id : m_order) if (id != None && !taken[id]) rest.push_back(id);
+    m_order.clear();
+    m_holes = 0;
+    for (const quint32 id : restored) {
+        m_order.push_back(id);
+        m_slots[id] = int(m_order.size()) - 1;
+    }
+    m_cursor = std::clamp(cursor, -1, int(m_order.size()) - 1);
+    m_last = last >= 0 && size_t(last) < ids.size() ? ids[last] : None;
+    for (const quint32 id : rest) scatter(id);
+    return true;
+}
+
+bool ShuffleQueue::save(const std::vector<quint32>& ids) const noexcept {
+    /*
+     * 编号只在本次运行中有效，写盘时换成行号。空位不写出，游标换算成写出后的位置
+     */
+    std::vector<qint32> rows(m_slots.size(), -1);
+    for (size_t row = 0; row < ids.size(); row++) if (ids[row] < rows.size()) rows[ids[row]] = qint32(row);
+    std::vector<qint32> order;
+    order.reserve(m_order.size());
+    qint32 cursor = -1;
+    for (int i = 0; i < int(m_order.size()); i++) {
+        if (m_order[i] == None || rows[m_order[i]] < 0) continue;
+        order.push_back(rows[m_order[i]]);
+        if (i <= m_cursor) cursor = qint32(order.size()) - 1;
+    }
+    QDir{}.mkpath(m_directory);
+    QSaveFile file{m_directory + "/" + m_fileName};
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out{&file};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << Magic << Version << cursor << (m_last < rows.size() ? rows[m_last] : qint32(-1)) << quint32(order.size());
+    for (const qint32 row : order) out << row;
+    return file.commit();
+}
+
+void ShuffleQueue::setMode(Mode mode) noexcept {
+    m_mode = mode;
+}
+
+void ShuffleQueue::insert(quint32 id, float weight, quint32 group) noexcept {
+    /*
+     * 记录权重和分组，并把曲目放到本轮尚未播放部分的随机位置
+     */
+    if (id >= m_slots.size()) {
+        m_slots.resize(id + 1, -1);
+        m_weights.resize(id + 1, 1.0f);
+        m_groups.resize(id + 1, 0);
+    }
+    m_weights[id] = weight;
+    m_groups[id] = group;
+    if (!contains(id)) scatter(id);
+}
+
+void ShuffleQueue::update(quint32 id, float weight, quint32 group) noexcept {
+    /*
+     * 元数据读取后更新权重和分组，下一轮洗牌时生效
+     */
+    if (!contains(id)) return;
+    m_weights[id] = weight;
+    m_groups[id] = group;
+}
+
+void ShuffleQueue::remove(quint32 id) noexcept {
+    /*
+     * 只把位置标成空位，不移动其他曲目；空位超过一半时整体压缩一次，均摊仍是 O(1)
+     */
+    if (!contains(id)) return;
+    m_order[m_slots[id]] = None;
+    m_slots[id] = -1;
+    if (m_last == id) m_last = None;
+    if (++m_holes > 64 && m_holes * 2 > int(m_order.size())) compact();
+}
+
+void ShuffleQueue::clear() noexcept {
+    m_order.clear();
+    m_slots.clear();
+    m_weights.clear();
+    m_groups.clear();
+    m_cursor = -1;
+    m_holes = 0;
+    m_last = None;
+}
+
+void ShuffleQueue::reshuffle() noexcept {
+    /*
+     * 按当前模式重新排列全部曲目并从头开始新的一轮，上一轮最后播放的曲目不放在第一首
+     */
+    std::vector<quint32> ids;
+    ids.reserve(m_order.size() - m_holes);
+    for (const quint32 id : m_order) if (id != None) ids.push_back(id);
+    arrange(ids);
+    if (ids.size() > 1 && ids.front() == m_last) std::swap(ids[0], ids[1]);
+    m_order.swap(ids);
+    for (int i = 0; i < int(m_order.size()); i++) m_slots[m_order[i]] = i;
+    m_cursor = -1;
+    m_holes = 0;
+}
+
+quint32 ShuffleQueue::next() noexcept {
+    /*
+     * 返回游标之后的第一首，不移动游标。本轮已经播完时先重新洗牌，再返回新一轮的第一首
+     */
+    for (int i = m_cursor + 1; i < int(m_order.size()); i++) if (m_order[i] != None) return m_order[i];
+    if (int(m_order.size()) == m_holes) return None;
+    if (m_cursor >= 0 && m_order[m_cursor] != None) m_last = m_order[m_cursor];
+    reshuffle();
+    return m_order.front();
+}
+
+quint32 ShuffleQueue::previous() noexcept {
+    /*
+     * 游标退回本轮中上一首播放的曲目并返回它，已经在本轮开头时返回 None
+     */
+    for (int i = m_cursor - 1; i >= 0; i--) {
+        if (m_order[i] == None) continue;
+        m_cursor = i;
+        return m_order[i];
+    }
+    return None;
+}
+
+void ShuffleQueue::played(quint32 id) noexcept {
+    /*
+     * 一首曲目开始播放。它还没轮到时换到游标的下一个位置并前移游标，本轮已经播放过的不改变顺序
+     */
+    if (!contains(id)) return;
+    const int position = m_slots[id];
+    if (position <= m_cursor) return;
+    const int target = m_cursor + 1;
+    if (position != target) {
+        const quint32 other = m_order[target];
+        place(target, id);
+        place(position, other);
+    }
+    m_cursor = target;
+}
+
+void ShuffleQueue::place(int position, quint32 id) noexcept {
+    m_order[position] = id;
+    if (id != None) m_slots[id] = position;
+}
+
+void ShuffleQueue::scatter(quint32 id) noexcept {
+    /*
+     * 追加到末尾后与游标之后的一个随机位置交换，相当于增量的 Fisher–Yates 洗牌，未播放部分仍是均匀随机的
+     */
+    m_order.push_back(id);
+    const int last = int(m_order.size()) - 1;
+    m_slots[id] = last;
+    const int position = std::uniform_int_distribution<int>(m_cursor + 1, last)(m_rng);
+    if (position == last) return;
+    const quint32 other = m_order[position];
+    place(position, id);
+    place(last, other);
+    if (other == None) {
+        m_order.pop_back();
+        m_holes--;
+    }
+}
+
+void ShuffleQueue::compact() noexcept {
+    /*
+     * 去掉所有空位，游标指向原位置之前最后一首仍在队列中的曲目
+     */
+    int cursor = -1, size = 0;
+    for (int i = 0; i < int(m_order.size()); i++) {
+        if (m_order[i] == None) continue;
+        if (i <= m_cursor) cursor = size;
+        place(size++, m_order[i]);
+    }
+    m_order.resize(size);
+    m_cursor = cursor;
+    m_holes = 0;
+}
+
+void ShuffleQueue::arrange(std::vector<quint32>& ids) noexcept {
+    /*
+     * Uniform 直接洗牌；Weighted 给每首生成 -ln(u)/w 作为键后排序，等价于按权重依次无放回抽取；
+     * ArtistSpread 把同一艺术家的 k 首以 1/k 为间隔放到 [0, 1) 上，起点和每首的位置都带随机扰动，再按位置排序
+     */
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    switch (m_mode) {
+    case Uniform:
+        std::shuffle(ids.begin(), ids.end(), m_rng);
+        break;
+    case Weighted: {
+        std::vector<std::pair<double, quint32>> keyed;
+        keyed.reserve(ids.size());
+        for (const quint32 id : ids) {
+            const double u = std::max(uniform(m_rng), 1e-12);
+            keyed.emplace_back(-std::log(u) / std::max(1e-3, double(m_weights[id])), id);
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (size_t i = 0; i < ids.size(); i++) ids[i] = keyed[i].second;
+        break;
+    }
+    case ArtistSpread: {
+        std::shuffle(ids.begin(), ids.end(), m_rng);
+        std::stable_sort(ids.begin(), ids.end(), [this](quint32 a, quint32 b) { return m_groups[a] < m_groups[b]; });
+        std::vector<std::pair<double, quint32>> keyed;
+        keyed.reserve(ids.size());
+        for (size_t begin = 0, end; begin < ids.size(); begin = end) {
+            for (end = begin + 1; end < ids.size() && m_groups[ids[end]] == m_groups[ids[begin]]; end++) {}
+            const double step = 1.0 / double(end - begin);
+            const double offset = uniform(m_rng) * step;
+            for (size_t i = begin; i < end; i++) {
+                const double jitter = (uniform(m_rng) - 0.5) * 0.2 * step;
+                keyed.emplace_back(offset + double(i - begin) * step + jitter, ids[i]);
+            }
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (size_t i = 0; i < ids.size(); i++) ids[i] = keyed[i].second;
+        break;
+    }
+    }
+}
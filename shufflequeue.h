@@ -0,0 +1,65 @@
+#ifndef SHUFFLEQUEUE_H
+#define SHUFFLEQUEUE_H
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <QString>
+
+/*
+ * 随机播放的队列，按曲目编号记录一轮中的播放顺序，游标之前是本轮已播放的曲目。
+ * 新曲目放到游标之后的随机位置，删除只留下空位，增删都是 O(1)；一轮播完后重新洗牌
+ */
+class ShuffleQueue {
+public:
+    enum Mode : quint8 {
+        Uniform,       // 每首概率相同
+        Weighted,      // 按权重抽取，权重高的更早出现
+        ArtistSpread   // 同一艺术家的曲目尽量均匀分散
+    };
+
+    static constexpr quint32 None = std::numeric_limits<quint32>::max();
+
+    ShuffleQueue() noexcept;
+
+    void setDirectory(const QString& directory, const QString& fileName) noexcept;
+    bool load(const std::vector<quint32>& ids) noexcept;
+    bool save(const std::vector<quint32>& ids) const noexcept;
+
+    void setMode(Mode mode) noexcept;
+    Mode mode() const noexcept { return m_mode; }
+
+    void insert(quint32 id, float weight, quint32 group) noexcept;
+    void update(quint32 id, float weight, quint32 group) noexcept;
+    void remove(quint32 id) noexcept;
+    void clear() noexcept;
+
+    void reshuffle() noexcept;
+    quint32 next() noexcept;
+    quint32 previous() noexcept;
+    void played(quint32 id) noexcept;
+
+private:
+    bool contains(quint32 id) const noexcept { return id < m_slots.size() && m_slots[id] >= 0; }
+    void place(int position, quint32 id) noexcept;
+    void scatter(quint32 id) noexcept;
+    void compact() noexcept;
+    void arrange(std::vector<quint32>& ids) noexcept;
+
+    static constexpr quint32 Magic = 0x57534831; // "WSH1"
+    static constexpr quint32 Version = 1;
+
+    QString m_directory, m_fileName;
+    Mode m_mode{Uniform};
+    std::vector<quint32> m_order;   // 本轮的播放顺序，删除留下的空位为 None
+    std::vector<qint32> m_slots;    // 按编号记录在 m_order 中的位置，不在队列中为 -1
+    std::vector<float> m_weights;   // 按编号记录的权重，Weighted 模式使用
+    std::vector<quint32> m_groups;  // 按编号记录的艺术家，ArtistSpread 模式使用
+    int m_cursor{-1};               // 当前曲目的位置，-1 表示本轮还没有开始
+    int m_holes{0};
+    quint32 m_last{None};           // 上一轮最后播放的曲目，新一轮不以它开头
+    std::mt19937 m_rng;
+};
+
+#endif // SHUFFLEQUEUE_H
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <numeric>
+
+#include <QLocale>
+
+#include "stringpool.h"
+
+quint32 StringPool::intern(const QString& text) noexcept {
+    /*
+     * 已存在时返回原有编号，否则追加。池中保存的是同一个隐式共享的 QString，不会再复制字符数据
+     */
+    const auto it = m_ids.constFind(text);
+    if (it != m_ids.cend()) return *it;
+    const quint32 id = quint32(m_strings.size());
+    m_strings.push_back(text);
+    m_ids.insert(text, id);
+    m_ranks.clear();
+    return id;
+}
+
+quint32 StringPool::rank(quint32 id) const noexcept {
+    /*
+     * 按艺术家或专辑排序时比较名次即可，名次相同说明是同一个字符串
+     */
+    if (m_ranks.size() != m_strings.size()) updateRanks();
+    return m_ranks[id];
+}
+
+QCollatorSortKey StringPool::sortKey(const QString& text) noexcept {
+    /*
+     * 使用中文排序规则，汉字按拼音排列，数字按数值比较，不区分大小写。只在主线程调用
+     */
+    static const QCollator collator = [] {
+        QCollator c(QLocale(QLocale::Chinese, QLocale::China));
+        c.setNumericMode(true);
+        c.setCaseSensitivity(Qt::CaseInsensitive);
+        return c;
+    }();
+    return collator.sortKey(text);
+}
+
+void StringPool::updateRanks() const noexcept {
+    /*
+     * 不同的艺术家和专辑通常只有几千个。新加入的字符串补上排序键，整体排一遍得到名次
+     */
+    m_keys.reserve(m_strings.size());
+    for (size_t id = m_keys.size(); id < m_strings.size(); id++) m_keys.push_back(sortKey(m_strings[id]));
+    std::vector<quint32> order(m_strings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](quint32 a, quint32 b) { return m_keys[a].compare(m_keys[b]) < 0; });
+    m_ranks.assign(m_strings.size(), 0);
+    for (quint32 i = 0; i < quint32(order.size()); i++) m_ranks[order[i]] = i;
+}
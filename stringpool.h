@@ -0,0 +1,32 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <vector>
+
+#include <QCollator>
+#include <QHash>
+#include <QString>
+
+/*
+ * 字符串驻留池：相同的字符串只保存一份，以编号引用。编号在池的生命周期内不变，不回收，
+ * 因此播放列表、元数据缓存和搜索索引可以共用一个池，比较和分组时只比较编号
+ */
+class StringPool {
+public:
+    quint32 intern(const QString& text) noexcept;
+    const QString& at(quint32 id) const noexcept { return m_strings[id]; }
+    quint32 size() const noexcept { return quint32(m_strings.size()); }
+    quint32 rank(quint32 id) const noexcept;
+
+    static QCollatorSortKey sortKey(const QString& text) noexcept;
+
+private:
+    void updateRanks() const noexcept;
+
+    std::vector<QString> m_strings;
+    QHash<QString, quint32> m_ids;
+    mutable std::vector<QCollatorSortKey> m_keys;  // 每个字符串的排序键，只生成一次
+    mutable std::vector<quint32> m_ranks;  // 按本地化排序规则的名次，池中加入新字符串后在下次查询时重算
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,547 @@
+#include <cmath>
+#include <limits>
+
+#include <QFile>
+#include <QStringDecoder>
+#include <QtEndian>
+
+#include "tagreader.h"
+
+namespace {
+
+constexpr qint64 MaxTagSize = 16 * 1024 * 1024;
+
+struct Tags {
+    QString title, artist, albumArtist, album;
+    QByteArray cover;
+    int coverType{-1};
+    qint64 duration{0};
+    int trackNumber{0};
+    float replayGain{std::numeric_limits<float>::quiet_NaN()};
+
+    void setCover(const QByteArray& data, int type) {
+        /*
+         * 优先保留封面正面（图片类型 3），否则保留遇到的第一张
+         */
+        if (data.isEmpty()) return;
+        if (cover.isEmpty() || (type == 3 && coverType != 3)) {
+            cover = data;
+            coverType = type;
+        }
+    }
+};
+
+quint16 be16(const char* p) { return qFromBigEndian<quint16>(p); }
+quint32 be24(const char* p) { return (quint32(uchar(p[0])) << 16) | (quint32(uchar(p[1])) << 8) | uchar(p[2]); }
+quint32 be32(const char* p) { return qFromBigEndian<quint32>(p); }
+quint64 be64(const char* p) { return qFromBigEndian<quint64>(p); }
+quint16 le16(const char* p) { return qFromLittleEndian<quint16>(p); }
+quint32 le32(const char* p) { return qFromLittleEndian<quint32>(p); }
+qint64 le64(const char* p) { return qFromLittleEndian<qint64>(p); }
+quint32 syncsafe(const char* p) {
+    return (quint32(uchar(p[0]) & 0x7f) << 21) | (quint32(uchar(p[1]) & 0x7f) << 14) | (quint32(uchar(p[2]) & 0x7f) << 7) | (uchar(p[3]) & 0x7f);
+}
+
+QByteArray readAt(QFile& file, qint64 offset, qint64 length) {
+    /*
+     * 只读取需要的区域，标签之外的音频数据不会被读入
+     */
+    if (offset < 0 || length <= 0 || !file.seek(offset)) return QByteArray();
+    return file.read(qMin(length, MaxTagSize));
+}
+
+QString clean(QString text) {
+    /*
+     * 多值字段只取第一个值，并去掉首尾空白
+     */
+    const int end = text.indexOf(QChar(0));
+    if (end >= 0) text.truncate(end);
+    return text.trimmed();
+}
+
+QString decodeLegacy(const QByteArray& bytes) {
+    /*
+     * 未声明编码的字段：合法的 UTF-8 按 UTF-8 解码，否则按 Latin-1
+     */
+    QStringDecoder decoder(QStringDecoder::Utf8);
+    const QString text = decoder.decode(bytes);
+    return clean(decoder.hasError() ? QString::fromLatin1(bytes) : text);
+}
+
+QString id3Text(int encoding, const QByteArray& bytes) {
+    switch (encoding) {
+    case 0: return decodeLegacy(bytes);
+    case 1:
+        if (bytes.startsWith("\xFE\xFF")) return clean(QStringDecoder(QStringDecoder::Utf16BE).decode(bytes.mid(2)));
+        if (bytes.startsWith("\xFF\xFE")) return clean(QStringDecoder(QStringDecoder::Utf16LE).decode(bytes.mid(2)));
+        return clean(QStringDecoder(QStringDecoder::Utf16LE).decode(bytes));
+    case 2: return clean(QStringDecoder(QStringDecoder::Utf16BE).decode(bytes));
+    case 3: return clean(QString::fromUtf8(bytes));
+    default: return QString();
+    }
+}
+
+qint64 skipTerminated(const QByteArray& data, qint64 pos, int encoding) {
+    /*
+     * 跳过以 0 结尾的字符串，UTF-16 编码以两个 0 字节结尾
+     */
+    if (encoding == 1 || encoding == 2) {
+        for (; pos + 1 < data.size(); pos += 2) if (data[pos] == 0 && data[pos + 1] == 0) return pos + 2;
+        return data.size();
+    }
+    const qint64 end = data.indexOf('\0', pos);
+    return end < 0 ? data.size() : end + 1;
+}
+
+float parseGain(const QString& text) {
+    /*
+     * ReplayGain 字段形如 "-6.54 dB"，单位可省略，解析失败时返回 NaN
+     */
+    QString value = text.trimmed();
+    if (value.endsWith("dB", Qt::CaseInsensitive)) value.chop(2);
+    bool ok = false;
+    const float gain = value.trimmed().toFloat(&ok);
+    return ok && std::isfinite(gain) ? gain : std::numeric_limits<float>::quiet_NaN();
+}
+
+int parseTrackNumber(const QString& text) {
+    /*
+     * 音轨号字段形如 "3" 或 "3/12"，只取斜杠前的部分，解析失败时返回 0
+     */
+    const int number = text.section('/', 0, 0).trimmed().toInt();
+    return number > 0 ? number : 0;
+}
+
+QByteArray removeUnsync(QByteArray data) {
+    return data.replace(QByteArray("\xFF\x00", 2), QByteArray("\xFF", 1));
+}
+
+void parseId3v2(const QByteArray& tag, Tags& tags) {
+    /*
+     * 解析 ID3v2.2/2.3/2.4 标签，tag 包含 10 字节的标签头
+     */
+    if (tag.size() < 10 || !tag.startsWith("ID3")) return;
+    const int major = uchar(tag[3]);
+    const uchar flags = uchar(tag[5]);
+    if (major < 2 || major > 4 || (major == 2 && (flags & 0x40))) return;
+    QByteArray body = tag.mid(10);
+    if ((flags & 0x80) && major < 4) body = removeUnsync(body);
+    qint64 pos = 0;
+    if ((flags & 0x40) && body.size() >= 4) pos = major == 4 ? syncsafe(body.constData()) : be32(body.constData()) + 4;
+    const int idLength = major == 2 ? 3 : 4, headLength = major == 2 ? 6 : 10;
+    while (pos + headLength <= body.size()) {
+        const char* head = body.constData() + pos;
+        if (head[0] == 0) break;
+        const QByteArray id(head, idLength);
+        const qint64 size = major == 2 ? be24(head + 3) : major == 4 ? syncsafe(head + 4) : be32(head + 4);
+        const quint16 frameFlags = major == 2 ? 0 : be16(head + 8);
+        pos += headLength;
+        if (size <= 0 || size > body.size() - pos) break;
+        QByteArray data = body.mid(pos, size);
+        pos += size;
+        if (major == 4) {
+            if (frameFlags & 0x000C) continue;
+            if (frameFlags & 0x0040) data.remove(0, 1);
+            if (frameFlags & 0x0002) data = removeUnsync(data);
+            if (frameFlags & 0x0001) data.remove(0, 4);
+        }
+        else if (major == 3) {
+            if (frameFlags & 0x00C0) continue;
+            if (frameFlags & 0x0020) data.remove(0, 1);
+        }
+        if (data.size() < 2) continue;
+        const int encoding = uchar(data[0]);
+        if (id == "TIT2" || id == "TT2") tags.title = id3Text(encoding, data.mid(1));
+        else if (id == "TPE1" || id == "TP1") tags.artist = id3Text(encoding, data.mid(1));
+        else if (id == "TPE2" || id == "TP2") tags.albumArtist = id3Text(encoding, data.mid(1));
+        else if (id == "TALB" || id == "TAL") tags.album = id3Text(encoding, data.mid(1));
+        else if (id == "TLEN" || id == "TLE") tags.duration = id3Text(encoding, data.mid(1)).toLongLong();
+        else if (id == "TRCK" || id == "TRK") tags.trackNumber = parseTrackNumber(id3Text(encoding, data.mid(1)));
+        else if (id == "APIC") {
+            qint64 p = data.indexOf('\0', 1);
+            if (p < 0 || p + 1 >= data.size()) continue;
+            const int type = uchar(data[p + 1]);
+            p = skipTerminated(data, p + 2, encoding);
+            tags.setCover(data.mid(p), type);
+        }
+        else if (id == "TXXX" || id == "TXX") {
+            const qint64 p = skipTerminated(data, 1, encoding);
+            if (id3Text(encoding, data.mid(1, p - 1)).compare("REPLAYGAIN_TRACK_GAIN", Qt::CaseInsensitive) == 0)
+                tags.replayGain = parseGain(id3Text(encoding, data.mid(p)));
+        }
+        else if (id == "PIC" && data.size() > 5) tags.setCover(data.mid(skipTerminated(data, 5, encoding)), uchar(data[4]));
+    }
+}
+
+void parseId3v1(const QByteArray& tag, Tags& tags) {
+    /*
+     * ID3v1 只用来补全 ID3v2 中缺失的字段
+     */
+    if (tag.size() < 128 || !tag.startsWith("TAG")) return;
+    if (tags.title.isEmpty()) tags.title = decodeLegacy(tag.mid(3, 30));
+    if (tags.artist.isEmpty()) tags.artist = decodeLegacy(tag.mid(33, 30));
+    if (tags.album.isEmpty()) tags.album = decodeLegacy(tag.mid(63, 30));
+}
+
+qint64 mpegDuration(QFile& file, qint64 audioStart, qint64 audioEnd) {
+    /*
+     * 找到第一个 MPEG 音频帧：有 Xing/Info/VBRI 头时按总帧数计算，否则按固定码率估算
+     */
+    static const int bitrates[5][16] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0},
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0},
+    };
+    static const int sampleRates[3] = {44100, 48000, 32000};
+    const QByteArray buf = readAt(file, audioStart, 64 * 1024);
+    const char* d = buf.constData();
+    for (qint64 i = 0; i + 4 <= buf.size(); i++) {
+        if (uchar(d[i]) != 0xFF || (uchar(d[i + 1]) & 0xE0) != 0xE0) continue;
+        const int version = (uchar(d[i + 1]) >> 3) & 3, layer = (uchar(d[i + 1]) >> 1) & 3;
+        const int bitrateIndex = uchar(d[i + 2]) >> 4, rateIndex = (uchar(d[i + 2]) >> 2) & 3;
+        const int padding = (uchar(d[i + 2]) >> 1) & 1;
+        const bool mono = (uchar(d[i + 3]) >> 6) == 3;
+        if (version == 1 || layer == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) continue;
+        const bool v1 = version == 3;
+        const int table = v1 ? 3 - layer : (layer == 3 ? 3 : 4);
+        const int bitrate = bitrates[table][bitrateIndex] * 1000;
+        const int sampleRate = sampleRates[rateIndex] >> (v1 ? 0 : version == 2 ? 1 : 2);
+        const int samplesPerFrame = layer == 3 ? 384 : (layer == 1 && !v1) ? 576 : 1152;
+        const qint64 frameLength = layer == 3 ? (12 * bitrate / sampleRate + padding) * 4 : qint64(samplesPerFrame) / 8 * bitrate / sampleRate + padding;
+        if (frameLength < 4) continue;
+        if (i + frameLength + 2 <= buf.size() && (uchar(d[i + frameLength]) != 0xFF || (uchar(d[i + frameLength + 1]) & 0xE0) != 0xE0)) continue;
+        const qint64 xing = i + 4 + (v1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+        if (xing + 12 <= buf.size() && (buf.mid(xing, 4) == "Xing" || buf.mid(xing, 4) == "Info") && (be32(d + xing + 4) & 1))
+            return qint64(be32(d + xing + 8)) * samplesPerFrame * 1000 / sampleRate;
+        const qint64 vbri = i + 4 + 32;
+        if (vbri + 18 <= buf.size() && buf.mid(vbri, 4) == "VBRI")
+            return qint64(be32(d + vbri + 14)) * samplesPerFrame * 1000 / sampleRate;
+        return (audioEnd - audioStart - i) * 8000 / bitrate;
+    }
+    return 0;
+}
+
+qint64 skipId3v2(QFile& file, Tags& tags) {
+    /*
+     * 解析文件开头可能存在的 ID3v2 标签，返回标签之后的偏移
+     */
+    const QByteArray head = readAt(file, 0, 10);
+    if (head.size() < 10 || !head.startsWith("ID3")) return 0;
+    const qint64 size = syncsafe(head.constData() + 6) + 10 + ((uchar(head[5]) & 0x10) ? 10 : 0);
+    parseId3v2(readAt(file, 0, size), tags);
+    return size;
+}
+
+bool parseMpeg(QFile& file, Tags& tags, bool mpegAudio) {
+    const qint64 audioStart = skipId3v2(file, tags);
+    qint64 audioEnd = file.size();
+    const QByteArray v1 = readAt(file, audioEnd - 128, 128);
+    if (v1.startsWith("TAG")) {
+        parseId3v1(v1, tags);
+        audioEnd -= 128;
+    }
+    if (mpegAudio && tags.duration <= 0) tags.duration = mpegDuration(file, audioStart, audioEnd);
+    return true;
+}
+
+void parseFlacPicture(const QByteArray& d, Tags& tags) {
+    /*
+     * FLAC PICTURE 块，也用于 Vorbis 注释中的 METADATA_BLOCK_PICTURE
+     */
+    if (d.size() < 8) return;
+    const int type = int(be32(d.constData()));
+    qint64 pos = 4 + qint64(be32(d.constData() + 4)) + 4;
+    if (pos > d.size()) return;
+    pos += qint64(be32(d.constData() + pos - 4)) + 16 + 4;
+    if (pos > d.size()) return;
+    const qint64 length = be32(d.constData() + pos - 4);
+    if (length > d.size() - pos) return;
+    tags.setCover(d.mid(pos, length), type);
+}
+
+void parseVorbisComment(const QByteArray& d, qint64 pos, Tags& tags) {
+    if (pos + 4 > d.size()) return;
+    pos += 4 + qint64(le32(d.constData() + pos));
+    if (pos + 4 > d.size()) return;
+    const quint32 count = le32(d.constData() + pos);
+    pos += 4;
+    for (quint32 i = 0; i < count && pos + 4 <= d.size(); i++) {
+        const qint64 length = le32(d.constData() + pos);
+        pos += 4;
+        if (length > d.size() - pos) break;
+        const QByteArray comment = d.mid(pos, length);
+        pos += length;
+        const qint64 eq = comment.indexOf('=');
+        if (eq <= 0) continue;
+        const QByteArray key = comment.left(eq).toUpper();
+        const QByteArray value = comment.mid(eq + 1);
+        if (key == "TITLE" && tags.title.isEmpty()) tags.title = clean(QString::fromUtf8(value));
+        else if (key == "ARTIST" && tags.artist.isEmpty()) tags.artist = clean(QString::fromUtf8(value));
+        else if (key == "ALBUMARTIST" && tags.albumArtist.isEmpty()) tags.albumArtist = clean(QString::fromUtf8(value));
+        else if (key == "ALBUM" && tags.album.isEmpty()) tags.album = clean(QString::fromUtf8(value));
+        else if (key == "TRACKNUMBER" && tags.trackNumber == 0) tags.trackNumber = parseTrackNumber(QString::fromUtf8(value));
+        else if (key == "REPLAYGAIN_TRACK_GAIN") tags.replayGain = parseGain(QString::fromUtf8(value));
+        else if (key == "R128_TRACK_GAIN" && std::isnan(tags.replayGain)) {
+            /*
+             * Opus 的 R128 增益是相对 -23 LUFS 的 Q7.8 定点数，换算到 ReplayGain 的 -18 LUFS 参考需要再加 5 dB
+             */
+            bool ok = false;
+            const int q78 = value.trimmed().toInt(&ok);
+            if (ok) tags.replayGain = float(q78) / 256.0f + 5.0f;
+        }
+        else if (key == "METADATA_BLOCK_PICTURE") parseFlacPicture(QByteArray::fromBase64(value), tags);
+    }
+}
+
+bool parseFlac(QFile& file, Tags& tags) {
+    /*
+     * 依次读取 FLAC 元数据块，只读入 STREAMINFO、VORBIS_COMMENT 和 PICTURE，其余块直接跳过
+     */
+    qint64 pos = skipId3v2(file, tags);
+    if (readAt(file, pos, 4) != "fLaC") return false;
+    pos += 4;
+    for (bool last = false; !last;) {
+        const QByteArray head = readAt(file, pos, 4);
+        if (head.size() < 4) return false;
+        last = uchar(head[0]) & 0x80;
+        const int type = uchar(head[0]) & 0x7F;
+        const qint64 length = be24(head.constData() + 1);
+        pos += 4;
+        if (type == 0 && length >= 18) {
+            const QByteArray info = readAt(file, pos, 18);
+            if (info.size() < 18) return false;
+            const char* p = info.constData();
+            const quint32 rate = (quint32(uchar(p[10])) << 12) | (quint32(uchar(p[11])) << 4) | (uchar(p[12]) >> 4);
+            const quint64 samples = (quint64(uchar(p[13]) & 0x0F) << 32) | be32(p + 14);
+            if (rate > 0) tags.duration = qint64(samples * 1000 / rate);
+        }
+        else if (type == 4) parseVorbisComment(readAt(file, pos, length), 0, tags);
+        else if (type == 6) parseFlacPicture(readAt(file, pos, length), tags);
+        pos += length;
+    }
+    return true;
+}
+
+bool parseOgg(QFile& file, Tags& tags) {
+    /*
+     * 拼出 Ogg 流的前两个包（标识头和注释头），时长取自文件末尾最后一页的 granule position
+     */
+    QList<QByteArray> packets;
+    QByteArray current;
+    qint64 offset = 0;
+    while (packets.size() < 2) {
+        const QByteArray head = readAt(file, offset, 27);
+        if (head.size() < 27 || !head.startsWith("OggS")) return false;
+        const int segments = uchar(head[26]);
+        const QByteArray lacing = file.read(segments);
+        if (lacing.size() < segments) return false;
+        qint64 bodySize = 0;
+        for (char c : lacing) bodySize += uchar(c);
+        const QByteArray body = file.read(bodySize);
+        if (body.size() < bodySize) return false;
+        qint64 p = 0;
+        for (int i = 0; i < segments && packets.size() < 2; i++) {
+            const int length = uchar(lacing[i]);
+            current.append(body.constData() + p, length);
+            p += length;
+            if (length < 255) {
+                packets.append(current);
+                current.clear();
+            }
+        }
+        if (current.size() > MaxTagSize) return false;
+        offset += 27 + segments + bodySize;
+    }
+    qint64 rate = 0, preSkip = 0;
+    const QByteArray& id = packets[0];
+    if (id.startsWith("\x01vorbis") && id.size() >= 16) {
+        rate = le32(id.constData() + 12);
+        if (packets[1].startsWith("\x03vorbis")) parseVorbisComment(packets[1], 7, tags);
+    }
+    else if (id.startsWith("OpusHead") && id.size() >= 12) {
+        rate = 48000;
+        preSkip = le16(id.constData() + 10);
+        if (packets[1].startsWith("OpusTags")) parseVorbisComment(packets[1], 8, tags);
+    }
+    else return false;
+    const qint64 size = file.size();
+    const qint64 tailStart = qMax<qint64>(0, size - 64 * 1024);
+    const QByteArray tail = readAt(file, tailStart, size - tailStart);
+    for (qint64 i = tail.lastIndexOf("OggS"); i >= 0 && rate > 0; i = i > 0 ? tail.lastIndexOf("OggS", i - 1) : -1) {
+        if (i + 14 > tail.size()) continue;
+        const qint64 granule = le64(tail.constData() + i + 6);
+        if (granule < 0) continue;
+        tags.duration = (granule - preSkip) * 1000 / rate;
+        break;
+    }
+    return true;
+}
+
+void parseMp4Boxes(const QByteArray& d, qint64 begin, qint64 end, Tags& tags, bool inIlst) {
+    /*
+     * 递归解析 moov 中的 mvhd（时长）和 udta/meta/ilst（标签与封面）
+     */
+    qint64 pos = begin;
+    while (pos + 8 <= end) {
+        quint64 size = be32(d.constData() + pos);
+        const QByteArray type = d.mid(pos + 4, 4);
+        qint64 head = 8;
+        if (size == 1) {
+            if (pos + 16 > end) break;
+            size = be64(d.constData() + pos + 8);
+            head = 16;
+        }
+        else if (size == 0) size = quint64(end - pos);
+        if (size < quint64(head) || size > quint64(end - pos)) break;
+        const qint64 body = pos + head, stop = pos + qint64(size);
+        pos = stop;
+        if (inIlst && type == "----") {
+            /*
+             * iTunes 自由格式字段：name 子块给出字段名，data 子块给出值
+             */
+            QByteArray name;
+            for (qint64 p = body; p + 12 <= stop;) {
+                const qint64 length = be32(d.constData() + p);
+                if (length < 12 || length > stop - p) break;
+                const QByteArray child = d.mid(p + 4, 4);
+                if (child == "name") name = d.mid(p + 12, length - 12).toLower();
+                else if (child == "data" && length >= 16 && name == "replaygain_track_gain")
+                    tags.replayGain = parseGain(QString::fromUtf8(d.mid(p + 16, length - 16)));
+                p += length;
+            }
+        }
+        else if (inIlst) {
+            qint64 p = body;
+            while (p + 16 <= stop) {
+                const qint64 length = be32(d.constData() + p);
+                if (length < 16 || length > stop - p) break;
+                if (d.mid(p + 4, 4) == "data") {
+                    const quint32 dataType = be32(d.constData() + p + 8) & 0xFFFFFF;
+                    const QByteArray value = d.mid(p + 16, length - 16);
+                    if (type == "\251nam") tags.title = clean(QString::fromUtf8(value));
+                    else if (type == "\251ART") tags.artist = clean(QString::fromUtf8(value));
+                    else if (type == "aART") tags.albumArtist = clean(QString::fromUtf8(value));
+                    else if (type == "\251alb") tags.album = clean(QString::fromUtf8(value));
+                    else if (type == "trkn" && value.size() >= 4) tags.trackNumber = be16(value.constData() + 2);
+                    else if (type == "covr" && (dataType == 13 || dataType == 14 || dataType == 0)) tags.setCover(value, 3);
+                    break;
+                }
+                p += length;
+            }
+        }
+        else if (type == "mvhd" && stop - body >= 20) {
+            const bool v1 = d[body] == 1;
+            if (v1 && stop - body < 32) continue;
+            const quint32 timescale = be32(d.constData() + body + (v1 ? 20 : 12));
+            const quint64 duration = v1 ? be64(d.constData() + body + 24) : be32(d.constData() + body + 16);
+            if (timescale > 0) tags.duration = qint64(duration * 1000 / timescale);
+        }
+        else if (type == "udta") parseMp4Boxes(d, body, stop, tags, false);
+        else if (type == "meta") {
+            const bool fullBox = !(stop - body >= 8 && d.mid(body + 4, 4) == "hdlr");
+            parseMp4Boxes(d, body + (fullBox ? 4 : 0), stop, tags, false);
+        }
+        else if (type == "ilst") parseMp4Boxes(d, body, stop, tags, true);
+    }
+}
+
+bool parseMp4(QFile& file, Tags& tags) {
+    /*
+     * 跳过顶层的 mdat 等大块，只把 moov 读入内存
+     */
+    const qint64 size = file.size();
+    qint64 offset = 0;
+    while (offset + 8 <= size) {
+        const QByteArray head = readAt(file, offset, 16);
+        if (head.size() < 8) break;
+        quint64 boxSize = be32(head.constData());
+        const QByteArray type = head.mid(4, 4);
+        qint64 headLength = 8;
+        if (boxSize == 1) {
+            if (head.size() < 16) break;
+            boxSize = be64(head.constData() + 8);
+            headLength = 16;
+        }
+        else if (boxSize == 0) boxSize = quint64(size - offset);
+        if (boxSize < quint64(headLength)) break;
+        if (offset == 0 && type != "ftyp") return false;
+        if (type == "moov") {
+            const QByteArray moov = readAt(file, offset + headLength, qint64(boxSize) - headLength);
+            parseMp4Boxes(moov, 0, moov.size(), tags, false);
+            return true;
+        }
+        offset += qint64(boxSize);
+    }
+    return false;
+}
+
+bool parseRiff(QFile& file, Tags& tags) {
+    /*
+     * 遍历 RIFF WAVE 的各个块，读取 fmt 与 LIST/INFO，data 块只取其大小
+     */
+    const QByteArray head = readAt(file, 0, 12);
+    if (head.size() < 12 || !head.startsWith("RIFF") || head.mid(8, 4) != "WAVE") return false;
+    const qint64 size = file.size();
+    qint64 offset = 12, dataSize = 0;
+    quint32 byteRate = 0;
+    while (offset + 8 <= size) {
+        const QByteArray chunk = readAt(file, offset, 8);
+        if (chunk.size() < 8) break;
+        const QByteArray id = chunk.left(4);
+        const qint64 length = le32(chunk.constData() + 4), body = offset + 8;
+        if (id == "fmt ") {
+            const QByteArray format = readAt(file, body, 16);
+            if (format.size() == 16) byteRate = le32(format.constData() + 8);
+        }
+        else if (id == "data") dataSize = qMin(length, size - body);
+        else if (id == "LIST") {
+            const QByteArray list = readAt(file, body, length);
+            if (list.startsWith("INFO")) for (qint64 p = 4; p + 8 <= list.size();) {
+                const QByteArray sub = list.mid(p, 4);
+                const qint64 subLength = le32(list.constData() + p + 4);
+                const QString value = decodeLegacy(list.mid(p + 8, subLength));
+                if (sub == "INAM") tags.title = value;
+                else if (sub == "IART") tags.artist = value;
+                else if (sub == "IPRD") tags.album = value;
+                else if (sub == "ITRK" || sub == "IPRT") tags.trackNumber = parseTrackNumber(value);
+                p += 8 + subLength + (subLength & 1);
+            }
+        }
+        else if (id == "id3 " || id == "ID3 ") parseId3v2(readAt(file, body, length), tags);
+        offset = body + length + (length & 1);
+    }
+    if (byteRate > 0) tags.duration = dataSize * 1000 / byteRate;
+    return true;
+}
+
+}
+
+bool TagReader::read(const QString& path, MusicTrack& track, QByteArray* cover) noexcept {
+    /*
+     * 直接解析 m_supportedFormats 中常见格式的标签。无法识别或拿不到时长时返回 false，由调用方回退到 QMediaPlayer。
+     * 内嵌封面以原始字节写入 cover，不在这里解码
+     */
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    Tags tags;
+    bool ok = false;
+    if (suffix == "mp3") ok = parseMpeg(file, tags, true);
+    else if (suffix == "flac") ok = parseFlac(file, tags);
+    else if (suffix == "ogg") ok = parseOgg(file, tags);
+    else if (suffix == "m4a") ok = parseMp4(file, tags);
+    else if (suffix == "aac") ok = parseMp4(file, tags) || parseMpeg(file, tags, false);
+    else if (suffix == "wav") ok = parseRiff(file, tags);
+    if (!ok || tags.duration <= 0) return false;
+    track.duration = tags.duration;
+    if (!tags.title.isEmpty()) track.title = tags.title;
+    if (!tags.artist.isEmpty()) track.artist = tags.artist;
+    else if (!tags.albumArtist.isEmpty()) track.artist = tags.albumArtist;
+    if (!tags.album.isEmpty()) track.album = tags.album;
+    track.trackNumber = tags.trackNumber;
+    track.replayGain = tags.replayGain;
+    if (cover != nullptr) *cover = tags.cover;
+    return true;
+}
@@ -0,0 +1,13 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QString>
+
+#include "musictrack.h"
+
+class TagReader {
+public:
+    static bool read(const QString& path, MusicTrack& track, QByteArray* cover = nullptr) noexcept;
+};
+
+#endif // TAGREADER_H
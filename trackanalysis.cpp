@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cmath>
+
+#include "trackanalysis.h"
+
+TrackAnalyzer::TrackAnalyzer(int sampleRate) noexcept : m_meter(sampleRate) {
+    /*
+     * 峰值和节拍检测都以 10 毫秒为一跳
+     */
+    m_hopFrames = std::max(1, sampleRate / 100);
+    m_hopRate = double(std::max(1, sampleRate)) / double(m_hopFrames);
+}
+
+void TrackAnalyzer::process(const qint16* interleaved, qint64 frames) noexcept {
+    m_meter.process(interleaved, frames);
+    constexpr double Scale = 1.0 / 65536.0;
+    for (qint64 i = 0; i < frames; i++) {
+        const int left = interleaved[i * 2], right = interleaved[i * 2 + 1];
+        m_hopMin = std::min({m_hopMin, left, right});
+        m_hopMax = std::max({m_hopMax, left, right});
+        const double mono = double(left + right) * Scale;
+        m_energy += mono * mono;
+        if (++m_hopFill < m_hopFrames) continue;
+        m_minima.push_back(qint16(m_hopMin));
+        m_maxima.push_back(qint16(m_hopMax));
+        m_energies.push_back(float(m_energy / double(m_hopFrames)));
+        m_hopMin = m_hopMax = 0;
+        m_hopFill = 0;
+        m_energy = 0.0;
+    }
+}
+
+TrackAnalysis TrackAnalyzer::finish() noexcept {
+    /*
+     * 波形把每 10 毫秒的最小值和最大值按时间均分到 WaveformBins 个格子里合并，缩放到一个字节，曲目过短时相邻格子重复同一个值
+     */
+    TrackAnalysis result;
+    result.loudness = float(m_meter.integratedLoudness());
+    result.peak = m_meter.peak();
+    result.bpm = detectTempo();
+    const qint64 count = qint64(m_minima.size());
+    if (count == 0) return result;
+    result.waveform.resize(TrackAnalysis::WaveformBins * 2);
+    for (int bin = 0; bin < TrackAnalysis::WaveformBins; bin++) {
+        const qint64 begin = bin * count / TrackAnalysis::WaveformBins;
+        const qint64 end = std::min(count, std::max(begin + 1, (bin + 1) * count / TrackAnalysis::WaveformBins));
+        const qint16 low = *std::min_element(m_minima.cbegin() + begin, m_minima.cbegin() + end);
+        const qint16 high = *std::max_element(m_maxima.cbegin() + begin, m_maxima.cbegin() + end);
+        result.waveform[bin * 2] = char(low >> 8);
+        result.waveform[bin * 2 + 1] = char(high >> 8);
+    }
+    return result;
+}
+
+float TrackAnalyzer::detectTempo() const noexcept {
+    /*
+     * 对数能量的正向差分作为起音强度，减去半秒内的局部均值后做自相关，在 60~200 BPM 对应的延迟中取峰值。
+     * 峰值按以 120 BPM 为中心的对数高斯加权，减少倍频误判，再用抛物线插值细化延迟。不足 10 秒或没有明显周期时返回 0
+     */
+    const qint64 n = qint64(m_energies.size());
+    if (n < qint64(m_hopRate * 10.0)) return 0.0f;
+    std::vector<float> onset(n, 0.0f);
+    for (qint64 t = 1; t < n; t++) onset[t] = std::max(0.0f, std::log1p(1000.0f * m_energies[t]) - std::log1p(1000.0f * m_energies[t - 1]));
+    const qint64 half = std::max<qint64>(1, qint64(m_hopRate * 0.25));
+    std::vector<float> centered(n);
+    double window = 0.0;
+    qint64 begin = 0, end = 0;
+    for (qint64 t = 0; t < n; t++) {
+        for (; end < std::min(n, t + half + 1); end++) window += onset[end];
+        for (; begin < t - half; begin++) window -= onset[begin];
+        centered[t] = std::max(0.0f, onset[t] - float(window / double(end - begin)));
+    }
+    const qint64 minLag = std::max<qint64>(2, qint64(std::floor(m_hopRate * 60.0 / 200.0)));
+    const qint64 maxLag = std::min<qint64>(n / 2, qint64(std::ceil(m_hopRate * 60.0 / 60.0)));
+    if (maxLag <= minLag + 1) return 0.0f;
+    std::vector<double> acf(maxLag + 2, 0.0);
+    for (qint64 lag = minLag - 1; lag <= maxLag + 1; lag++) {
+        double sum = 0.0;
+        for (qint64 t = 0; t + lag < n; t++) sum += double(centered[t]) * double(centered[t + lag]);
+        acf[lag] = sum / double(n - lag);
+    }
+    qint64 best = -1;
+    double bestScore = 0.0;
+    for (qint64 lag = minLag; lag <= maxLag; lag++) {
+        const double octaves = std::log2(m_hopRate * 60.0 / double(lag) / 120.0);
+        const double score = acf[lag] * std::exp(-0.5 * octaves * octaves / 0.81);
+        if (score > bestScore) {
+            bestScore = score;
+            best = lag;
+        }
+    }
+    if (best < 0) return 0.0f;
+    const double left = acf[best - 1], middle = acf[best], right = acf[best + 1];
+    const double curvature = left - 2.0 * middle + right;
+    const double shift = curvature < 0.0 ? std::clamp(0.5 * (left - right) / curvature, -0.5, 0.5) : 0.0;
+    return float(m_hopRate * 60.0 / (double(best) + shift));
+}
@@ -0,0 +1,45 @@
+#ifndef TRACKANALYSIS_H
+#define TRACKANALYSIS_H
+
+#include <limits>
+#include <vector>
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include "loudnessmeter.h"
+
+struct TrackAnalysis {
+    static constexpr int WaveformBins = 400;
+
+    float loudness{std::numeric_limits<float>::quiet_NaN()};  // 综合响度（LUFS），静音时为 NaN
+    float peak{0.0f};     // 采样峰值，满幅为 1
+    float bpm{0.0f};      // 检测不到稳定节拍时为 0
+    QByteArray waveform;  // WaveformBins 个格子按时间均分，每个格子依次是最小值和最大值（有符号字节）
+
+    float replayGain() const noexcept { return float(LoudnessMeter::ReferenceLoudness) - loudness; }
+};
+
+/*
+ * 对一首曲目解码后的 16 位立体声做整体分析，数据可以分多次送入，最后由 finish 汇总
+ */
+class TrackAnalyzer {
+public:
+    explicit TrackAnalyzer(int sampleRate) noexcept;
+
+    void process(const qint16* interleaved, qint64 frames) noexcept;
+    TrackAnalysis finish() noexcept;
+
+private:
+    float detectTempo() const noexcept;
+
+    LoudnessMeter m_meter;
+    qint64 m_hopFrames, m_hopFill{0};
+    double m_hopRate;
+    double m_energy{0.0};
+    int m_hopMin{0}, m_hopMax{0};
+    std::vector<qint16> m_minima, m_maxima;  // 每 10 毫秒的最小值和最大值
+    std::vector<float> m_energies;  // 每 10 毫秒单声道混合后的能量，用于节拍检测
+};
+
+#endif // TRACKANALYSIS_H
@@ -0,0 +1,142 @@
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+
+#include "tracklibrary.h"
+
+void TrackLibrary::setDirectory(const QString& directory) noexcept {
+    m_directory = directory;
+}
+
+bool TrackLibrary::load() noexcept {
+    /*
+     * 读取路径表和各播放列表的编号序列。魔数或版本不符、内容损坏时保持为空，由调用方决定如何初始化。
+     * 去重键为空表示与路径相同
+     */
+    QFile file{m_directory + "/library.bin"};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version, pathCount, playlistCount;
+    qint32 current;
+    in >> magic >> version >> current >> pathCount;
+    if (in.status() != QDataStream::Ok || magic != Magic || version < 1 || version > Version) return false;
+    std::vector<QString> paths, keys;
+    paths.reserve(std::min<quint32>(pathCount, 1 << 20));
+    keys.reserve(paths.capacity());
+    for (quint32 i = 0; i < pathCount; i++) {
+        QString path, key;
+        in >> path;
+        if (version >= 2) in >> key;
+        if (in.status() != QDataStream::Ok) return false;
+        paths.push_back(path);
+        keys.push_back(key.isEmpty() ? path : key);
+    }
+    in >> playlistCount;
+    bool ok = in.status() == QDataStream::Ok;
+    std::vector<Playlist> playlists(ok ? std::min<quint32>(playlistCount, 1 << 16) : 0);
+    for (Playlist& playlist : playlists) {
+        quint32 count;
+        in >> playlist.name >> count;
+        if (in.status() != QDataStream::Ok || count > pathCount) {
+            ok = false;
+            break;
+        }
+        playlist.tracks.resize(count);
+        for (quint32& id : playlist.tracks) in >> id;
+        if (in.status() != QDataStream::Ok || std::any_of(playlist.tracks.cbegin(), playlist.tracks.cend(), [pathCount](quint32 id) { return id >= pathCount; })) {
+            ok = false;
+            break;
+        }
+    }
+    if (!ok || playlists.empty()) return false;
+    m_paths.swap(paths);
+    m_keys.swap(keys);
+    m_ids.clear();
+    m_ids.reserve(qsizetype(m_paths.size()));
+    for (quint32 id = 0; id < m_paths.size(); id++) m_ids.insert(m_paths[id], id);
+    m_playlists.swap(playlists);
+    m_current = std::clamp(current, 0, count() - 1);
+    return true;
+}
+
+bool TrackLibrary::save() const noexcept {
+    /*
+     * 只写出仍被某个列表引用的路径，编号按写出的顺序重排
+     */
+    std::vector<qint32> remap(m_paths.size(), -1);
+    std::vector<quint32> used;
+    for (const Playlist& playlist : m_playlists) for (const quint32 id : playlist.tracks) {
+        if (remap[id] >= 0) continue;
+        remap[id] = qint32(used.size());
+        used.push_back(id);
+    }
+    QDir{}.mkpath(m_directory);
+    QSaveFile file{m_directory + "/library.bin"};
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    QDataStream out{&file};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << Magic << Version << qint32(m_current) << quint32(used.size());
+    for (const quint32 id : used) out << m_paths[id] << (m_keys[id] == m_paths[id] ? QString() : m_keys[id]);
+    out << quint32(m_playlists.size());
+    for (const Playlist& playlist : m_playlists) {
+        out << playlist.name << quint32(playlist.tracks.size());
+        for (const quint32 id : playlist.tracks) out << quint32(remap[id]);
+    }
+    return file.commit();
+}
+
+quint32 TrackLibrary::intern(const QString& path, const QString& key) noexcept {
+    /*
+     * 已有的路径改用这次给出的去重键
+     */
+    const auto it = m_ids.constFind(path);
+    if (it != m_ids.cend()) {
+        m_keys[*it] = key;
+        return *it;
+    }
+    const quint32 id = quint32(m_paths.size());
+    m_paths.push_back(path);
+    m_keys.push_back(key);
+    m_ids.insert(path, id);
+    return id;
+}
+
+void TrackLibrary::setCurrent(int index) noexcept {
+    if (index >= 0 && index < count()) m_current = index;
+}
+
+int TrackLibrary::create(const QString& name) noexcept {
+    m_playlists.push_back(Playlist{name, {}});
+    return count() - 1;
+}
+
+void TrackLibrary::rename(int index, const QString& name) noexcept {
+    if (index >= 0 && index < count()) m_playlists[index].name = name;
+}
+
+void TrackLibrary::remove(int index) noexcept {
+    /*
+     * 删除一个列表，当前列表的序号随之调整。路径表不动，下次保存时不再被引用的路径自然被清理
+     */
+    if (index < 0 || index >= count()) return;
+    m_playlists.erase(m_playlists.begin() + index);
+    if (m_current > index || m_current >= count()) m_current = std::max(0, m_current - 1);
+}
+
+void TrackLibrary::setTracks(int index, const std::vector<QString>& paths, const QHash<QString, QString>& keys) noexcept {
+    /*
+     * 用播放列表当前的路径顺序替换它的编号序列。keys 只包含去重键与路径不同的那些路径
+     */
+    if (index < 0 || index >= count()) return;
+    std::vector<quint32>& tracks = m_playlists[index].tracks;
+    tracks.clear();
+    tracks.reserve(paths.size());
+    for (const QString& path : paths) {
+        const auto it = keys.constFind(path);
+        tracks.push_back(intern(path, it != keys.cend() ? *it : path));
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TRACKLIBRARY_H
+#define TRACKLIBRARY_H
+
+#include <vector>
+
+#include <QHash>
+#include <QString>
+
+/*
+ * 曲目库和命名播放列表：每个文件路径在库中有一个编号，播放列表只保存编号序列。
+ * 每个路径同时记下加入时算出的去重键（规范路径），打开列表时直接用来去重，不必再访问文件。
+ * 编号在本次运行中不变，写盘时只保留仍被某个列表引用的路径并重新编号
+ */
+class TrackLibrary {
+public:
+    void setDirectory(const QString& directory) noexcept;
+    bool load() noexcept;
+    bool save() const noexcept;
+
+    quint32 intern(const QString& path, const QString& key) noexcept;
+    const QString& path(quint32 id) const noexcept { return m_paths[id]; }
+    const QString& key(quint32 id) const noexcept { return m_keys[id]; }
+    const std::vector<QString>& paths() const noexcept { return m_paths; }
+
+    int count() const noexcept { return int(m_playlists.size()); }
+    int current() const noexcept { return m_current; }
+    void setCurrent(int index) noexcept;
+    const QString& name(int index) const noexcept { return m_playlists[index].name; }
+    int create(const QString& name) noexcept;
+    void rename(int index, const QString& name) noexcept;
+    void remove(int index) noexcept;
+    const std::vector<quint32>& tracks(int index) const noexcept { return m_playlists[index].tracks; }
+    void setTracks(int index, const std::vector<QString>& paths, const QHash<QString, QString>& keys) noexcept;
+
+private:
+    struct Playlist {
+        QString name;
+        std::vector<quint32> tracks;  // 库中的编号，按列表顺序
+    };
+
+    static constexpr quint32 Magic = 0x574C4231; // "WLB1"
+    static constexpr quint32 Version = 2;  // 版本 1 没有去重键，读取时按路径本身处理
+
+    QString m_directory;
+    std::vector<QString> m_paths;
+    std::vector<QString> m_keys;  // 与路径相同时共用同一份字符串数据
+    QHash<QString, quint32> m_ids;
+    std::vector<Playlist> m_playlists;
+    int m_current{0};
+};
+
+#endif // TRACKLIBRARY_H
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <limits>
+
+#include "tracktable.h"
+
+namespace {
+
+qint32 clampDuration(qint64 milliseconds) {
+    return qint32(std::clamp<qint64>(milliseconds, 0, std::numeric_limits<qint32>::max()));
+}
+
+template <typename T>
+void eraseRows(std::vector<T>& column, const std::vector<int>& rows) {
+    /*
+     * rows 已按升序排列且不重复，保留的元素一次前移到位
+     */
+    size_t write = size_t(rows.front()), next = 0;
+    for (size_t read = write; read < column.size(); read++) {
+        if (next < rows.size() && size_t(rows[next]) == read) {
+            next++;
+            continue;
+        }
+        column[write++] = std::move(column[read]);
+    }
+    column.resize(write);
+}
+
+template <typename T>
+void gather(std::vector<T>& column, const std::vector<int>& rows) {
+    std::vector<T> result;
+    result.reserve(column.size());
+    for (const int row : rows) result.push_back(std::move(column[row]));
+    column.swap(result);
+}
+
+quint16 clampNumber(int number) {
+    return quint16(std::clamp(number, 0, int(std::numeric_limits<quint16>::max())));
+}
+
+}
+
+void TrackTable::reserve(int count) noexcept {
+    /*
+     * 至少按现有容量翻倍，逐批追加时不会每次都重新分配
+     */
+    if (size_t(count) <= m_paths.capacity()) return;
+    count = std::max<int>(count, int(m_paths.capacity() * 2));
+    for (auto* column : {&m_paths, &m_titles}) column->reserve(count);
+    for (auto* column : {&m_artists, &m_albums, &m_covers, &m_ids}) column->reserve(count);
+    for (auto* column : {&m_sizes, &m_mtimes}) column->reserve(count);
+    m_durations.reserve(count);
+    m_numbers.reserve(count);
+    m_gains.reserve(count);
+    m_resolved.reserve(count);
+}
+
+void TrackTable::clear() noexcept {
+    /*
+     * 清空所有列。驻留池中的字符串保留，编号仍被缓存和索引引用
+     */
+    m_paths.clear();
+    m_titles.clear();
+    m_artists.clear();
+    m_albums.clear();
+    m_covers.clear();
+    m_durations.clear();
+    m_numbers.clear();
+    m_sizes.clear();
+    m_mtimes.clear();
+    m_gains.clear();
+    m_ids.clear();
+    m_resolved.clear();
+    m_rows.clear();
+    m_pathIds.clear();
+}
+
+void TrackTable::append(const MusicTrack& track, bool resolved) noexcept {
+    m_paths.push_back(track.filePath);
+    m_titles.push_back(track.title);
+    m_artists.push_back(m_strings.intern(track.artist));
+    m_albums.push_back(m_strings.intern(track.album));
+    m_covers.push_back(m_strings.intern(track.coverKey));
+    m_durations.push_back(clampDuration(track.duration));
+    m_numbers.push_back(clampNumber(track.trackNumber));
+    m_sizes.push_back(track.size);
+    m_mtimes.push_back(track.mtime);
+    m_gains.push_back(track.replayGain);
+    m_ids.push_back(track.id);
+    m_resolved.push_back(resolved);
+    if (track.id >= m_rows.size()) m_rows.resize(std::max<size_t>(size_t(track.id) + 1, m_rows.size() * 2), -1);
+    m_rows[track.id] = qint32(m_ids.size()) - 1;
+    m_pathIds.insert(track.filePath, track.id);
+}
+
+void TrackTable::set(int row, const MusicTrack& track) noexcept {
+    if (m_paths[row] != track.filePath) m_pathIds.remove(m_paths[row]);
+    m_pathIds.insert(track.filePath, track.id);
+    m_paths[row] = track.filePath;
+    m_titles[row] = track.title;
+    m_artists[row] = m_strings.intern(track.artist);
+    m_albums[row] = m_strings.intern(track.album);
+    m_covers[row] = m_strings.intern(track.coverKey);
+    m_durations[row] = clampDuration(track.duration);
+    m_numbers[row] = clampNumber(track.trackNumber);
+    m_sizes[row] = track.size;
+    m_mtimes[row] = track.mtime;
+    m_gains[row] = track.replayGain;
+    if (m_ids[row] != track.id) {
+        m_rows[m_ids[row]] = -1;
+        if (track.id >= m_rows.size()) m_rows.resize(size_t(track.id) + 1, -1);
+        m_rows[track.id] = row;
+    }
+    m_ids[row] = track.id;
+    m_resolved[row] = true;
+}
+
+void TrackTable::remove(const std::vector<int>& rows) noexcept {
+    /*
+     * 删除一批行，rows 按升序排列且不重复。各列只遍历一次，之后各行的编号索引跟着前移
+     */
+    if (rows.empty()) return;
+    for (const int row : rows) {
+        m_rows[m_ids[row]] = -1;
+        m_pathIds.remove(m_paths[row]);
+    }
+    eraseRows(m_paths, rows);
+    eraseRows(m_titles, rows);
+    eraseRows(m_artists, rows);
+    eraseRows(m_albums, rows);
+    eraseRows(m_covers, rows);
+    eraseRows(m_durations, rows);
+    eraseRows(m_numbers, rows);
+    eraseRows(m_sizes, rows);
+    eraseRows(m_mtimes, rows);
+    eraseRows(m_gains, rows);
+    eraseRows(m_ids, rows);
+    eraseRows(m_resolved, rows);
+    indexRows(rows.front());
+}
+
+void TrackTable::permute(const std::vector<int>& rows) noexcept {
+    /*
+     * 按新顺序重排所有列，rows[i] 是排在第 i 位的原行号
+     */
+    gather(m_paths, rows);
+    gather(m_titles, rows);
+    gather(m_artists, rows);
+    gather(m_albums, rows);
+    gather(m_covers, rows);
+    gather(m_durations, rows);
+    gather(m_numbers, rows);
+    gather(m_sizes, rows);
+    gather(m_mtimes, rows);
+    gather(m_gains, rows);
+    gather(m_ids, rows);
+    gather(m_resolved, rows);
+    indexRows(0);
+}
+
+void TrackTable::swap(TrackTable& other) noexcept {
+    /*
+     * 与另一张表交换全部内容，只交换各列的缓冲区。两张表必须共用同一个驻留池
+     */
+    m_paths.swap(other.m_paths);
+    m_titles.swap(other.m_titles);
+    m_artists.swap(other.m_artists);
+    m_albums.swap(other.m_albums);
+    m_covers.swap(other.m_covers);
+    m_durations.swap(other.m_durations);
+    m_numbers.swap(other.m_numbers);
+    m_sizes.swap(other.m_sizes);
+    m_mtimes.swap(other.m_mtimes);
+    m_gains.swap(other.m_gains);
+    m_ids.swap(other.m_ids);
+    m_resolved.swap(other.m_resolved);
+    m_rows.swap(other.m_rows);
+    m_pathIds.swap(other.m_pathIds);
+}
+
+int TrackTable::find(const QString& path) const noexcept {
+    /*
+     * 按路径查找所在的行，不在表中返回 -1
+     */
+    const auto it = m_pathIds.constFind(path);
+    return it != m_pathIds.cend() ? find(*it) : -1;
+}
+
+void TrackTable::indexRows(int from) noexcept {
+    for (int row = from; row < int(m_ids.size()); row++) m_rows[m_ids[row]] = row;
+}
+
+MusicTrack TrackTable::track(int row) const noexcept {
+    MusicTrack track;
+    track.filePath = m_paths[row];
+    track.title = m_titles[row];
+    track.artist = artist(row);
+    track.album = album(row);
+    track.coverKey = coverKey(row);
+    track.duration = m_durations[row];
+    track.trackNumber = m_numbers[row];
+    track.size = m_sizes[row];
+    track.mtime = m_mtimes[row];
+    track.replayGain = m_gains[row];
+    track.id = m_ids[row];
+    return track;
+}
@@ -0,0 +1,66 @@
+#ifndef TRACKTABLE_H
+#define TRACKTABLE_H
+
+#include <vector>
+
+#include <QString>
+#include <QHash>
+
+#include "musictrack.h"
+#include "stringpool.h"
+
+/*
+ * 按列存放播放列表的曲目：路径和标题各一列，艺术家、专辑和封面引用驻留后只存编号，数值字段各占一个数组。
+ * 需要完整信息时用 track() 临时拼出 MusicTrack。驻留池由外部提供，与缓存和索引共用
+ */
+class TrackTable {
+public:
+    explicit TrackTable(StringPool& strings) noexcept : m_strings(strings) {}
+
+    int size() const noexcept { return int(m_paths.size()); }
+    void reserve(int count) noexcept;
+    void clear() noexcept;
+    void append(const MusicTrack& track, bool resolved = true) noexcept;
+    void set(int row, const MusicTrack& track) noexcept;
+    void remove(const std::vector<int>& rows) noexcept;
+    void permute(const std::vector<int>& rows) noexcept;
+    void swap(TrackTable& other) noexcept;
+    MusicTrack track(int row) const noexcept;
+
+    const QString& path(int row) const noexcept { return m_paths[row]; }
+    const QString& title(int row) const noexcept { return m_titles[row]; }
+    const QString& artist(int row) const noexcept { return m_strings.at(m_artists[row]); }
+    const QString& album(int row) const noexcept { return m_strings.at(m_albums[row]); }
+    const QString& coverKey(int row) const noexcept { return m_strings.at(m_covers[row]); }
+    quint32 artistId(int row) const noexcept { return m_artists[row]; }
+    quint32 albumId(int row) const noexcept { return m_albums[row]; }
+    qint64 duration(int row) const noexcept { return m_durations[row]; }
+    int trackNumber(int row) const noexcept { return m_numbers[row]; }
+    qint64 fileSize(int row) const noexcept { return m_sizes[row]; }
+    qint64 mtime(int row) const noexcept { return m_mtimes[row]; }
+    float replayGain(int row) const noexcept { return m_gains[row]; }
+    quint32 id(int row) const noexcept { return m_ids[row]; }
+    bool resolved(int row) const noexcept { return m_resolved[row]; }
+    void setResolved(int row, bool resolved) noexcept { m_resolved[row] = resolved; }
+    const std::vector<QString>& paths() const noexcept { return m_paths; }
+    const std::vector<quint32>& ids() const noexcept { return m_ids; }
+    int find(quint32 id) const noexcept { return id < m_rows.size() ? m_rows[id] : -1; }
+    int find(const QString& path) const noexcept;
+
+private:
+    void indexRows(int from) noexcept;
+
+    std::vector<QString> m_paths, m_titles;
+    std::vector<quint32> m_artists, m_albums, m_covers;  // StringPool 中的编号
+    std::vector<qint32> m_durations;                     // 毫秒
+    std::vector<quint16> m_numbers;                      // 音轨号
+    std::vector<qint64> m_sizes, m_mtimes;
+    std::vector<float> m_gains;
+    std::vector<quint32> m_ids;
+    std::vector<bool> m_resolved;  // 元数据已经从缓存取出或交给读取线程，否则只有按路径生成的占位信息
+    std::vector<qint32> m_rows;  // 按编号记录所在的行，不在表中为 -1
+    QHash<QString, quint32> m_pathIds;  // 按路径记录编号，再经 m_rows 找到所在的行
+    StringPool& m_strings;
+};
+
+#endif // TRACKTABLE_H
@@ -0,0 +1,69 @@
+#include <algorithm>
+
+#include "transitiongraph.h"
+
+void TransitionGraph::played(quint32 id) noexcept {
+    /*
+     * 一首曲目开始播放，它与上一首之间的转移等到它播完或被跳过时再计分
+     */
+    m_previous = m_current;
+    m_current = id;
+    m_scored = false;
+    m_recent[m_recentHead] = id;
+    m_recentHead = (m_recentHead + 1) % RecentCount;
+    m_recentCount = std::min(m_recentCount + 1, RecentCount);
+}
+
+void TransitionGraph::finished(quint32 id, bool completed, qint64 position) noexcept {
+    /*
+     * 听完给上一首到这一首的转移加分；跳过时扣分，刚开始就跳过的扣得更多
+     */
+    if (id != m_current || m_scored) return;
+    m_scored = true;
+    if (m_previous == None || m_previous == id) return;
+    if (completed) add(m_previous, id, CompleteScore);
+    else add(m_previous, id, position < EarlySkip ? -EarlySkipPenalty : -LateSkipPenalty);
+}
+
+quint32 TransitionGraph::next(const std::function<bool(quint32)>& accept) const noexcept {
+    /*
+     * 沿当前曲目这一行按分数从高到低找第一首可以播放、最近没有播放过的曲目，没有正分的候选时返回 None
+     */
+    if (m_current >= m_rows.size()) return None;
+    for (const Edge& edge : m_rows[m_current]) {
+        if (edge.score <= 0.0f) break;
+        if (std::find(m_recent, m_recent + m_recentCount, edge.to) != m_recent + m_recentCount) continue;
+        if (accept(edge.to)) return edge.to;
+    }
+    return None;
+}
+
+void TransitionGraph::clear() noexcept {
+    m_rows.clear();
+    m_previous = m_current = None;
+    m_scored = true;
+    m_recentCount = m_recentHead = 0;
+}
+
+void TransitionGraph::add(quint32 from, quint32 to, float delta) noexcept {
+    /*
+     * 更新一条边后把它向前或向后挪到有序的位置，通常只移动一两格。
+     * 行已满时新边只能替换分数最低的一条，分数还不如它就丢弃
+     */
+    if (from >= m_rows.size()) m_rows.resize(size_t(from) + 1);
+    std::vector<Edge>& row = m_rows[from];
+    auto it = std::find_if(row.begin(), row.end(), [to](const Edge& edge) { return edge.to == to; });
+    size_t i;
+    if (it != row.end()) {
+        it->score += delta;
+        i = size_t(it - row.begin());
+    } else if (row.size() < MaxEdges) {
+        row.push_back({to, delta});
+        i = row.size() - 1;
+    } else if (delta > row.back().score) {
+        row.back() = {to, delta};
+        i = row.size() - 1;
+    } else return;
+    for (; i > 0 && row[i - 1].score < row[i].score; i--) std::swap(row[i - 1], row[i]);
+    for (; i + 1 < row.size() && row[i + 1].score > row[i].score; i++) std::swap(row[i + 1], row[i]);
+}
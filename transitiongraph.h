@@ -0,0 +1,45 @@
+#ifndef TRANSITIONGRAPH_H
+#define TRANSITIONGRAPH_H
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <QtGlobal>
+
+/*
+ * 曲目之间的转移图：A 之后播放 B 并听完时 A→B 加分，很快跳过时扣分。
+ * 按 A 分行稀疏存储，每行最多 MaxEdges 条边并保持按分数降序，更新和查询都只涉及当前曲目这一行
+ */
+class TransitionGraph {
+public:
+    static constexpr quint32 None = std::numeric_limits<quint32>::max();
+
+    void played(quint32 id) noexcept;
+    void finished(quint32 id, bool completed, qint64 position) noexcept;
+    quint32 next(const std::function<bool(quint32)>& accept) const noexcept;
+    void clear() noexcept;
+
+private:
+    struct Edge {
+        quint32 to;
+        float score;
+    };
+
+    void add(quint32 from, quint32 to, float delta) noexcept;
+
+    static constexpr int MaxEdges = 64;
+    static constexpr int RecentCount = 16;         // 最近播放过的这么多首不再推荐
+    static constexpr qint64 EarlySkip = 30000;     // 开始后这么多毫秒内跳过算作不喜欢
+    static constexpr float CompleteScore = 1.0f;
+    static constexpr float EarlySkipPenalty = 1.0f;
+    static constexpr float LateSkipPenalty = 0.25f;
+
+    std::vector<std::vector<Edge>> m_rows;  // 按起点编号，每行按分数降序
+    quint32 m_previous{None}, m_current{None};
+    bool m_scored{true};                     // 当前曲目的结果已经计入转移
+    quint32 m_recent[RecentCount];
+    int m_recentCount{0}, m_recentHead{0};
+};
+
+#endif // TRANSITIONGRAPH_H
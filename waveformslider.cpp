@@ -0,0 +1,177 @@
+#include <algorithm>
+
+#include <QEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScreen>
+#include <QStyle>
+
+#include "waveformslider.h"
+
+WaveformSlider::WaveformSlider(QWidget* parent) noexcept : QSlider(Qt::Horizontal, parent) {
+    m_frameTimer.setSingleShot(true);
+    connect(&m_frameTimer, &QTimer::timeout, this, [this] {
+        if (!m_pending) return;
+        m_pending = false;
+        flushPlayhead();
+    });
+}
+
+void WaveformSlider::setWaveform(const QByteArray& waveform) noexcept {
+    /*
+     * waveform 是按时间均分的若干个格子，每个格子依次存放最小值和最大值（有符号字节）
+     */
+    if (waveform == m_waveform) return;
+    m_waveform = waveform;
+    invalidateTiles();
+    update();
+}
+
+void WaveformSlider::invalidateTiles() noexcept {
+    for (std::vector<QPixmap>& tiles : m_tiles) tiles.clear();
+}
+
+const QPixmap& WaveformSlider::tile(int part, int index) noexcept {
+    /*
+     * 按需绘制图块：每个像素列合并对应格子的最小值和最大值画一条竖线。尺寸、配色或缩放比例变化后整体重建
+     */
+    const qreal ratio = devicePixelRatioF();
+    if (ratio != m_tileRatio) {
+        invalidateTiles();
+        m_tileRatio = ratio;
+    }
+    std::vector<QPixmap>& tiles = m_tiles[part];
+    if (tiles.empty()) tiles.resize((width() + TileWidth - 1) / TileWidth);
+    QPixmap& pixmap = tiles[index];
+    if (!pixmap.isNull()) return pixmap;
+    const int left = index * TileWidth, w = std::min(TileWidth, width() - left), h = height();
+    pixmap = QPixmap(QSize(w, h) * ratio);
+    pixmap.setDevicePixelRatio(ratio);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setPen(palette().color(part == 0 ? QPalette::Highlight : QPalette::Mid));
+    const int bins = int(m_waveform.size() / 2), total = width();
+    const int middle = h / 2, half = std::max(1, h / 2 - 2);
+    for (int x = 0; x < w; x++) {
+        const int begin = int(qint64(left + x) * bins / total);
+        const int end = std::max(begin + 1, int(qint64(left + x + 1) * bins / total));
+        int low = 0, high = 0;
+        for (int i = begin; i < std::min(end, bins); i++) {
+            low = std::min(low, int(qint8(m_waveform[i * 2])));
+            high = std::max(high, int(qint8(m_waveform[i * 2 + 1])));
+        }
+        painter.drawLine(x, middle - std::max(1, high * half / 127), x, middle + std::max(1, -low * half / 128));
+    }
+    return pixmap;
+}
+
+void WaveformSlider::paintEvent(QPaintEvent* event) {
+    /*
+     * 只绘制需要更新的区域：与之相交的图块以播放位置为界，左边取已播放图块，右边取未播放图块
+     */
+    if (m_waveform.isEmpty()) {
+        QSlider::paintEvent(event);
+        return;
+    }
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    const int playhead = playheadX();
+    const int first = std::max(0, dirty.left() / TileWidth), last = std::min((width() - 1) / TileWidth, dirty.right() / TileWidth);
+    for (int index = first; index <= last; index++) {
+        const QRect area = QRect(index * TileWidth, 0, TileWidth, height()).intersected(dirty);
+        const QRect clips[2] = {
+            area.intersected(QRect(0, 0, playhead, height())),
+            area.intersected(QRect(playhead, 0, width() - playhead, height()))
+        };
+        for (int part = 0; part < 2; part++) {
+            if (clips[part].isEmpty()) continue;
+            painter.setClipRect(clips[part]);
+            painter.drawPixmap(index * TileWidth, 0, tile(part, index));
+        }
+    }
+    painter.setClipping(false);
+    painter.setPen(palette().color(QPalette::Highlight));
+    painter.drawLine(playhead, 0, playhead, height() - 1);
+    m_paintedX = playhead;
+}
+
+void WaveformSlider::resizeEvent(QResizeEvent* event) {
+    invalidateTiles();
+    QSlider::resizeEvent(event);
+}
+
+void WaveformSlider::changeEvent(QEvent* event) {
+    if (event->type() == QEvent::PaletteChange || event->type() == QEvent::StyleChange) invalidateTiles();
+    QSlider::changeEvent(event);
+}
+
+void WaveformSlider::sliderChange(SliderChange change) {
+    /*
+     * 播放位置变化不重绘整个控件。距上次重绘不足一帧时只做标记，等下一帧再合并处理
+     */
+    if (m_waveform.isEmpty() || change != SliderValueChange) {
+        QSlider::sliderChange(change);
+        return;
+    }
+    if (m_frameTimer.isActive()) {
+        m_pending = true;
+        return;
+    }
+    flushPlayhead();
+}
+
+void WaveformSlider::flushPlayhead() noexcept {
+    /*
+     * 把新旧播放位置之间的区域标记为需要重绘，然后按屏幕刷新率启动下一帧的计时
+     */
+    const int x = playheadX();
+    if (x == m_paintedX || !isVisible()) return;
+    if (m_paintedX < 0) update();
+    else update(QRect(std::min(x, m_paintedX) - 1, 0, std::abs(x - m_paintedX) + 3, height()));
+    const qreal rate = screen() != nullptr ? screen()->refreshRate() : 60.0;
+    m_frameTimer.start(std::max(1, int(1000.0 / std::max<qreal>(rate, 1.0))));
+}
+
+int WaveformSlider::playheadX() const noexcept {
+    const qint64 range = qint64(maximum()) - minimum();
+    if (range <= 0) return 0;
+    return int((qint64(sliderPosition()) - minimum()) * (width() - 1) / range);
+}
+
+void WaveformSlider::mousePressEvent(QMouseEvent* event) {
+    /*
+     * 有波形时点击任意位置直接跳转到该处并开始拖动，而不是按页步进
+     */
+    if (m_waveform.isEmpty() || event->button() != Qt::LeftButton) {
+        QSlider::mousePressEvent(event);
+        return;
+    }
+    m_dragging = true;
+    setSliderDown(true);
+    setSliderPosition(valueAt(event->position().toPoint().x()));
+    event->accept();
+}
+
+void WaveformSlider::mouseMoveEvent(QMouseEvent* event) {
+    if (!m_dragging) {
+        QSlider::mouseMoveEvent(event);
+        return;
+    }
+    setSliderPosition(valueAt(event->position().toPoint().x()));
+    event->accept();
+}
+
+void WaveformSlider::mouseReleaseEvent(QMouseEvent* event) {
+    if (!m_dragging || event->button() != Qt::LeftButton) {
+        QSlider::mouseReleaseEvent(event);
+        return;
+    }
+    m_dragging = false;
+    setSliderPosition(valueAt(event->position().toPoint().x()));
+    setSliderDown(false);
+    event->accept();
+}
+
+int WaveformSlider::valueAt(int x) const noexcept {
+    return QStyle::sliderValueFromPosition(minimum(), maximum(), x, width());
+}
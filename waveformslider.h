@@ -0,0 +1,51 @@
+#ifndef WAVEFORMSLIDER_H
+#define WAVEFORMSLIDER_H
+
+#include <array>
+#include <vector>
+
+#include <QByteArray>
+#include <QPixmap>
+#include <QSlider>
+#include <QTimer>
+
+/*
+ * 以曲目波形作为背景的进度条。波形按固定宽度切成图块缓存，已播放和未播放各一份，
+ * 播放位置移动时只重绘新旧位置之间的区域，重绘频率不超过屏幕刷新率。没有波形数据时按普通滑块显示
+ */
+class WaveformSlider : public QSlider {
+    Q_OBJECT
+
+public:
+    static constexpr int TileWidth = 256;
+
+    explicit WaveformSlider(QWidget* parent = nullptr) noexcept;
+
+    void setWaveform(const QByteArray& waveform) noexcept;
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void sliderChange(SliderChange change) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+
+private:
+    const QPixmap& tile(int part, int index) noexcept;
+    void invalidateTiles() noexcept;
+    void flushPlayhead() noexcept;
+    int playheadX() const noexcept;
+    int valueAt(int x) const noexcept;
+
+    QByteArray m_waveform;
+    std::array<std::vector<QPixmap>, 2> m_tiles;  // 0 为已播放部分的颜色，1 为未播放部分
+    qreal m_tileRatio{0.0};
+    QTimer m_frameTimer;
+    int m_paintedX{-1};
+    bool m_pending{false};
+    bool m_dragging{false};
+};
+
+#endif // WAVEFORMSLIDER_H